@@ -0,0 +1,48 @@
+#ifndef __ADV_BUDGET_H__
+#define __ADV_BUDGET_H__
+
+#include <stdint.h>
+
+#include <zephyr/bluetooth/bluetooth.h>
+
+/* Allocator of the CONFIG_BT_EXT_ADV_MAX_ADV_SET advertising sets. Mesh
+ * creates its own sets (one, CONFIG_BT_MESH_RELAY_ADV_SETS relay sets and
+ * the optional separate GATT and friend sets) at bt_mesh_init and never
+ * gives them back, so they are reserved up front whatever the init order.
+ * The application gets the rest by priority: once every application set is
+ * taken, a create preempts the lowest priority set below its own.
+ */
+
+enum adv_budget_prio {
+	ADV_BUDGET_PRIO_LOW,
+	ADV_BUDGET_PRIO_NORMAL,
+	ADV_BUDGET_PRIO_HIGH,
+};
+
+/* The set was stopped and deleted for a higher priority one and must not be
+ * used any more. Called from the preempting create with the budget locked,
+ * must not call back into adv_budget.
+ */
+typedef void (*adv_budget_preempted_t)(struct bt_le_ext_adv *adv);
+
+struct adv_budget_stats {
+	uint8_t total;
+	uint8_t mesh;
+	uint8_t app;
+	uint32_t denied;
+	uint32_t preempted;
+};
+
+int adv_budget_start(void);
+
+/* -ENOMEM once every application set is taken at prio or above. A set
+ * created without a preempted callback is never preempted.
+ */
+int adv_budget_create(const struct bt_le_adv_param *param, const struct bt_le_ext_adv_cb *cb,
+		      enum adv_budget_prio prio, adv_budget_preempted_t preempted,
+		      struct bt_le_ext_adv **adv);
+int adv_budget_delete(struct bt_le_ext_adv *adv);
+
+void adv_budget_stats_get(struct adv_budget_stats *stats);
+
+#endif /* __ADV_BUDGET_H__ */
@@ -0,0 +1,33 @@
+#ifndef __ADV_CTRL_H__
+#define __ADV_CTRL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <zephyr/bluetooth/bluetooth.h>
+
+/* Owns the peer advertising set for its whole lifetime. Parameter switches
+ * stop the set, update it in place and restart it, instead of deleting and
+ * creating it again. The time without advertising is measured per switch.
+ */
+
+struct adv_ctrl_stats {
+	uint32_t switches;
+	/* Switches where the in-place update failed and the set was recreated */
+	uint32_t recreates;
+	uint32_t gap_last_us;
+	uint32_t gap_max_us;
+	uint64_t gap_total_us;
+};
+
+/* Data is kept by reference and must stay valid */
+int adv_ctrl_start(const struct bt_le_adv_param *param, const struct bt_le_ext_adv_cb *cb,
+		   const struct bt_data *ad, size_t ad_len,
+		   const struct bt_data *sd, size_t sd_len);
+
+/* Must not be called from the Bluetooth RX thread */
+int adv_ctrl_param_set(const struct bt_le_adv_param *param);
+
+void adv_ctrl_stats_get(struct adv_ctrl_stats *stats);
+
+#endif /* __ADV_CTRL_H__ */
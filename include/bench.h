@@ -0,0 +1,25 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Scale run metrics, compiled in with CONFIG_BL_BENCH. Every instance logs
+ * one BENCH line per report period, scripts/bsim_run.sh collects them from
+ * all simulated devices.
+ */
+
+int bench_start(bool provisioner);
+
+/* Node side, this device got provisioned */
+void bench_provisioned(void);
+
+/* Provisioner side, a node finished configuration */
+void bench_node_configured(uint16_t addr);
+
+/* A peer entered the table at timestamp_ms, only the first time a hw_id is
+ * seen counts towards discovery, peers that aged out and came back do not.
+ */
+void bench_peer_discovered(uint64_t hw_id, uint32_t timestamp_ms);
+
+#endif /* __BENCH_H__ */
@@ -0,0 +1,32 @@
+#ifndef __BOOT_H__
+#define __BOOT_H__
+
+#include <stdint.h>
+
+/* Boot milestones, in microseconds of uptime. Each one is recorded the
+ * first time it is reached and logged as a BOOT line. Once the device is
+ * operational (Bluetooth and mesh up, advertising) a summary line with
+ * operational_us is logged, the number to regress against.
+ */
+
+enum boot_milestone {
+	BOOT_HW_READY,
+	BOOT_BT_READY,
+	BOOT_MESH_READY,
+	BOOT_FIRST_ADV,
+	BOOT_FIRST_PEER,
+	BOOT_PROVISIONED,
+
+	BOOT_MILESTONE_COUNT,
+};
+
+/* Any context, later calls for the same milestone are ignored */
+void boot_mark(enum boot_milestone milestone);
+
+/* Microseconds of uptime at the milestone, -1 if not reached yet */
+int32_t boot_milestone_us(enum boot_milestone milestone);
+
+/* Microseconds of uptime when the device became operational, -1 if not yet */
+int32_t boot_operational_us(void);
+
+#endif /* __BOOT_H__ */
@@ -0,0 +1,41 @@
+#ifndef __COMP_CACHE_H__
+#define __COMP_CACHE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Parsed Composition Data Page 0 layouts, keyed by the product identifiers
+ * of the composition header. Only the models that need an app key binding
+ * are kept. Not thread safe, callers serialize access.
+ */
+
+struct comp_cache_key {
+	uint16_t cid;
+	uint16_t pid;
+	uint16_t vid;
+	uint16_t crpl;
+};
+
+struct comp_cache_bind {
+	uint8_t elem_offset;
+	uint16_t id;
+	/* 0xFFFF for SIG models */
+	uint16_t cid;
+};
+
+/* Returns the number of binds copied, -ENOENT if the product is unknown */
+int comp_cache_get(const struct comp_cache_key *key, struct comp_cache_bind *binds, size_t max);
+
+/* Our nodes carry their product identifiers in the upper half of the
+ * device UUID, the lower half is the folded hardware id (hw_config.c).
+ * This lets the provisioner find the product before any composition data
+ * is fetched.
+ */
+void comp_cache_key_to_uuid(const struct comp_cache_key *key, uint8_t uuid[16]);
+bool comp_cache_key_from_uuid(const uint8_t uuid[16], struct comp_cache_key *key);
+
+int comp_cache_put(const struct comp_cache_key *key, uint8_t elem_count,
+		   const struct comp_cache_bind *binds, size_t count);
+
+#endif /* __COMP_CACHE_H__ */
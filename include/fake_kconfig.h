@@ -3,10 +3,173 @@
 
 #define BL_NORDIC_COMPANY_ID 0x0059
 #define CONFIG_BL_COMPOSITION_COMPANY_ID BL_NORDIC_COMPANY_ID
+/* Part of the product key in the device UUID, bump the version whenever the
+ * model layout changes so provisioners stop using their cached bindings
+ */
+#define CONFIG_BL_COMPOSITION_PRODUCT_ID 0x0001
+#define CONFIG_BL_COMPOSITION_VERSION_ID 0x0001
 
-#define CONFIG_BL_MESH_PROVISIONING_STACK_SIZE 2048
-#define CONFIG_BL_MESH_PROVISIONING_PRIORITY -2
+/* Builds that can act as provisioner, from the button or the stored role at
+ * boot or after a handover. Node only builds set it to 0: the proximity
+ * graph and the peer query mirrors shrink to one entry and handovers are
+ * refused.
+ */
+#define CONFIG_BL_PROVISIONER 1
+
+#define CONFIG_BL_MESH_PROV_UUID_QUEUE_SIZE 32
+#define CONFIG_BL_MESH_PROV_UUID_CACHE_SIZE 32
+#define CONFIG_BL_MESH_PROV_BACKOFF_BASE_MS 2000
+#define CONFIG_BL_MESH_PROV_BACKOFF_MAX_MS 60000
+#define CONFIG_BL_MESH_PROV_LINK_TIMEOUT_MS 10000
+#define CONFIG_BL_MESH_PROV_TIMEOUT_MS 30000
+#define CONFIG_BL_MESH_PROV_IDLE_PERIOD_MS 5000
+
+/* Node configuration, in-flight requests should not exceed CONFIG_BT_MESH_TX_SEG_MSG_COUNT */
+#define CONFIG_BL_MESH_CFG_MAX_INFLIGHT 4
+#define CONFIG_BL_MESH_CFG_MAX_JOBS 8
+#define CONFIG_BL_MESH_CFG_MAX_BINDS 16
+#define CONFIG_BL_MESH_CFG_TIMEOUT_MS 5000
+#define CONFIG_BL_MESH_CFG_RETRIES 3
+#define CONFIG_BL_MESH_COMP_CACHE_SIZE 4
+
+/* Provisioner handover, each message is retried on timeout. The receiving
+ * node drops a partial import after the idle timeout.
+ */
+#define CONFIG_BL_ROLE_HANDOVER_TIMEOUT_MS 2000
+#define CONFIG_BL_ROLE_HANDOVER_RETRIES 3
+#define CONFIG_BL_ROLE_HANDOVER_BUSY_RETRY_MS 1000
+#define CONFIG_BL_ROLE_HANDOVER_IDLE_MS 15000
+
+/* Peer sightings reported into the mesh. Only the sightings model of the
+ * provisioner subscribes to the group, node_config adds it.
+ */
+#define CONFIG_BL_SIGHTINGS_GROUP 0xC0F0
+#define CONFIG_BL_SIGHTINGS_APP_IDX 0
+#define CONFIG_BL_SIGHTINGS_CHECK_MS 1000
+#define CONFIG_BL_SIGHTINGS_MAX_DELAY_MS 5000
+#define CONFIG_BL_SIGHTINGS_REFRESH_MS 30000
+#define CONFIG_BL_SIGHTINGS_RSSI_DELTA 6
+
+/* Remote peer table query. Removals are remembered for delta responses
+ * until this many newer ones were made, a client further behind gets the
+ * full table. A quarter of the peer capacity, 12 bytes each. The client mirrors the tables of this many nodes. The
+ * provisioner polls one configured node per period, round robin over the
+ * nodes that hold a mirror, so polling never evicts one.
+ */
+#define CONFIG_BL_PEER_QUERY_APP_IDX 0
+#define CONFIG_BL_PEER_QUERY_RSSI_DELTA 6
+#define CONFIG_BL_PEER_QUERY_TOMBSTONES (CONFIG_BL_PEER_CAPACITY / 4)
+#if CONFIG_BL_PROVISIONER
+#define CONFIG_BL_PEER_QUERY_MIRRORS 4
+#else
+#define CONFIG_BL_PEER_QUERY_MIRRORS 1
+#endif
+#define CONFIG_BL_PEER_QUERY_POLL_MS 3000
+
+/* Proximity graph of the provisioner, 12 bytes per vertex plus 2 per table
+ * slot and 14 bytes per edge. The arrays are static and reserved by every
+ * provisioner capable build: about 15.4 KB on nrf52_bsim and 13.3 KB
+ * elsewhere. Off bsim, the edges cover every peer of every node the 16
+ * node CDB holds. The vertex table size must be a power of two, the vertex
+ * count at most 3/4 of it. Edges age out after the timeout, the sweep
+ * visits AGING_STEP edges every AGING_MS.
+ */
+#if !CONFIG_BL_PROVISIONER
+#define CONFIG_BL_PROX_VERTEX_TABLE_SIZE 2
+#define CONFIG_BL_PROX_VERTICES 1
+#define CONFIG_BL_PROX_EDGES 1
+#elif defined(CONFIG_BOARD_NRF52_BSIM)
+#define CONFIG_BL_PROX_VERTEX_TABLE_SIZE 128
+#define CONFIG_BL_PROX_VERTICES 96
+#define CONFIG_BL_PROX_EDGES 1024
+#else
+#define CONFIG_BL_PROX_VERTEX_TABLE_SIZE 256
+#define CONFIG_BL_PROX_VERTICES 192
+#define CONFIG_BL_PROX_EDGES 768
+#endif
+#define CONFIG_BL_PROX_EDGE_TIMEOUT_MS 90000
+#define CONFIG_BL_PROX_RSSI_EMA_SHIFT 2
+#define CONFIG_BL_PROX_AGING_MS 1000
+#define CONFIG_BL_PROX_AGING_STEP 128
+#define CONFIG_BL_PROX_NEAREST_MAX 8
+
+/* Mesh statistics, a report period of 0 only reports on demand */
+#define CONFIG_BL_MESH_STATS_SAMPLE_MS 100
+#define CONFIG_BL_MESH_STATS_REPORT_MS 30000
 
 #define CONFIG_SENSIBLE_DATA 1
 
+/* Peer store, about 21 bytes per peer plus 2 per table slot. The table
+ * size must be a power of two, the capacity at most 3/4 of it. Peer
+ * queries name peers by 8 bit ids, which caps the capacity at 255. 192 is
+ * the most a 256 slot table holds. Counting the sighting state, the query
+ * view and, on provisioners, the query mirrors, a peer costs about 110
+ * bytes, 21 KB in all.
+ */
+#define CONFIG_BL_PEER_TABLE_SIZE 256
+#define CONFIG_BL_PEER_CAPACITY 192
+#define CONFIG_BL_PEER_NEAREST_MAX 8
+#define CONFIG_BL_PEER_TIMEOUT_MS 3000
+/* RSSI smoothing factor is 1 / 2^shift */
+#define CONFIG_BL_PEER_RSSI_EMA_SHIFT 3
+/* Peer table snapshot in NVS, written at most once per interval */
+#define CONFIG_BL_PEER_STORE_MAX 8
+#define CONFIG_BL_PEER_STORE_INTERVAL_MS (5 * 60 * 1000)
+
+/* Scan sightings, ring size must be a power of two */
+#define CONFIG_BL_SIGHTING_RING_SIZE 64
+#define CONFIG_BL_SIGHTING_BATCH 16
+#define CONFIG_BL_PEER_QUEUE_STACK_SIZE 1536
+#define CONFIG_BL_PEER_QUEUE_PRIORITY 5
+
+/* Scan scheduler */
+#define CONFIG_BL_SCAN_SCHED_PERIOD_MS 1000
+#define CONFIG_BL_SCAN_SCHED_HOLD_MS 5000
+/* Mesh messages heard per period above which the mesh counts as busy */
+#define CONFIG_BL_SCAN_SCHED_MESH_BUSY 20
+/* Peer advertising interval per mode, units of 0.625 ms */
+#define CONFIG_BL_SCAN_SCHED_DISCOVERY_INT_MIN 0x00a0
+#define CONFIG_BL_SCAN_SCHED_DISCOVERY_INT_MAX 0x00f0
+#define CONFIG_BL_SCAN_SCHED_TRACKING_INT_MIN 0x0140
+#define CONFIG_BL_SCAN_SCHED_TRACKING_INT_MAX 0x0190
+#define CONFIG_BL_SCAN_SCHED_RELAXED_INT_MIN 0x0320
+#define CONFIG_BL_SCAN_SCHED_RELAXED_INT_MAX 0x03c0
+
+/* Scale run metrics, see scripts/bsim_run.sh */
+#if defined(CONFIG_BOARD_NRF52_BSIM)
+#define CONFIG_BL_BENCH 1
+/* Distinct peers counted for discovery, any beyond are not counted.
+ * bsim_run.sh runs up to 64 devices.
+ */
+#define CONFIG_BL_BENCH_PEERS 64
+#else
+#define CONFIG_BL_BENCH 0
+#define CONFIG_BL_BENCH_PEERS 1
+#endif
+#define CONFIG_BL_BENCH_REPORT_MS 5000
+
+/* Binary event trace, drained to RTT or to the bl,trace-uart chosen node.
+ * Simulations have no RTT and keep the text logs.
+ */
+#if defined(CONFIG_BOARD_NRF52_BSIM)
+#define CONFIG_BL_TRACE 0
+#else
+#define CONFIG_BL_TRACE 1
+#endif
+/* RTT when the build has it, else the UART */
+#if defined(CONFIG_USE_SEGGER_RTT)
+#define CONFIG_BL_TRACE_BACKEND_RTT 1
+#else
+#define CONFIG_BL_TRACE_BACKEND_RTT 0
+#endif
+#define CONFIG_BL_TRACE_RTT_CHANNEL 1
+#define CONFIG_BL_TRACE_RTT_BUF_SIZE 1024
+#define CONFIG_BL_TRACE_RING_SIZE 128
+#define CONFIG_BL_TRACE_DRAIN_BATCH 16
+#define CONFIG_BL_TRACE_DRAIN_MS 100
+/* Per module switches */
+#define CONFIG_BL_TRACE_ADV 1
+#define CONFIG_BL_TRACE_PEER 1
+#define CONFIG_BL_TRACE_PROV 1
+
 #endif /* __FAKE_KCONFIG__ */
\ No newline at end of file
@@ -10,4 +10,8 @@ extern uint64_t dev_uid64;
 int hw_init(bool provisioner_button_value_if_not_dk);
 bool hw_provisioner_button_pressed(void);
 
+/* Called from the button work on every press of the handover button */
+typedef void (*hw_button_cb_t)(void);
+void hw_handover_button_cb_set(hw_button_cb_t cb);
+
 #endif /* __HW_CONFIG_H__ */
\ No newline at end of file
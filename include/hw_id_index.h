@@ -0,0 +1,60 @@
+#ifndef __HW_ID_INDEX_H__
+#define __HW_ID_INDEX_H__
+
+#include <stdint.h>
+
+#include <zephyr/sys/util.h>
+
+/* Open-addressed hash index of 16 bit indices into an array of hw_ids,
+ * used by the peer table and the proximity graph. Linear probing over a
+ * power of two number of slots, with backward shift deletion so lookups
+ * never need tombstones. The caller owns both arrays and keeps the load
+ * below 3/4 so that probe sequences stay short.
+ *
+ * Slots hold the index plus one and zero marks a free slot, so a table in
+ * .bss is a valid empty index before hw_id_index_clear runs. Go through
+ * hw_id_index_get and hw_id_index_set instead of the slots.
+ */
+
+/* Returned for a free slot */
+#define HW_ID_INDEX_NONE UINT16_MAX
+
+struct hw_id_index {
+	uint16_t *slots;
+	/* Slot count less one */
+	uint32_t mask;
+	const uint64_t *ids;
+};
+
+#define HW_ID_INDEX_INIT(_slots, _ids)				\
+	{							\
+		.slots = (_slots),				\
+		.mask = ARRAY_SIZE(_slots) - 1,			\
+		.ids = (_ids),					\
+	}
+
+/* Fibonacci hashing, hw_id may have a poor low-bit distribution */
+static inline uint32_t hw_id_hash(uint64_t hw_id)
+{
+	return (uint32_t)((hw_id * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+static inline uint16_t hw_id_index_get(const struct hw_id_index *index, uint32_t slot)
+{
+	return (uint16_t)(index->slots[slot] - 1);
+}
+
+static inline void hw_id_index_set(const struct hw_id_index *index, uint32_t slot, uint16_t idx)
+{
+	index->slots[slot] = idx + 1;
+}
+
+void hw_id_index_clear(const struct hw_id_index *index);
+
+/* Returns the slot holding hw_id, or the first free slot of its probe sequence */
+uint32_t hw_id_index_find(const struct hw_id_index *index, uint64_t hw_id);
+
+/* Frees slot, moving back the entries of its run that probed past it */
+void hw_id_index_remove(const struct hw_id_index *index, uint32_t slot);
+
+#endif /* __HW_ID_INDEX_H__ */
@@ -0,0 +1,44 @@
+#ifndef __MESH_STATS_H__
+#define __MESH_STATS_H__
+
+#include <stdint.h>
+
+/* Sampled view of the mesh advertising queues, built on the mesh stack
+ * statistics (CONFIG_BT_MESH_STATISTIC). Mesh does not expose its buffer
+ * pools, so queued, high_water, saturated and queue_time_ms are estimates:
+ * occupancy is carried from the transmissions planned and sent between
+ * samples, and a sample at the pool size counts as saturated. A send that
+ * fails after it was planned is never subtracted, so the estimate errs high.
+ *
+ * failed is measured: bt_mesh_adv_create is linked with --wrap (see
+ * CMakeLists.txt) and every NULL it returns is counted against the queue of
+ * its tag. For the relay queue, each one is a relayed message dropped.
+ */
+
+struct mesh_stats_queue {
+	uint32_t planned;
+	uint32_t sent;
+	uint32_t failed;
+	uint16_t pool_size;
+	uint16_t queued;
+	uint16_t high_water;
+	uint32_t saturated;
+	/* Mean time queued over the last report period, from Little's law */
+	uint32_t queue_time_ms;
+};
+
+struct mesh_stats {
+	struct mesh_stats_queue relay;
+	struct mesh_stats_queue local;
+	uint32_t rx_adv;
+	uint32_t rx_proxy;
+	uint32_t samples;
+};
+
+int mesh_stats_start(void);
+void mesh_stats_get(struct mesh_stats *stats);
+
+/* Logs the current figures, also done every CONFIG_BL_MESH_STATS_REPORT_MS */
+void mesh_stats_report(void);
+
+#endif /* __MESH_STATS_H__ */
@@ -0,0 +1,41 @@
+#ifndef __MESH_VND_H__
+#define __MESH_VND_H__
+
+#include <zephyr/bluetooth/mesh.h>
+
+#include "fake_kconfig.h"
+
+/* Vendor models of this application, all under
+ * CONFIG_BL_COMPOSITION_COMPANY_ID. Opcodes are unique across models.
+ */
+
+#define VND_OP(op) BT_MESH_MODEL_OP_3(op, CONFIG_BL_COMPOSITION_COMPANY_ID)
+
+/* Largest vendor message parameters: 12 bytes per segment, less the
+ * transport MIC and the 3 byte opcode
+ */
+#define VND_PAYLOAD_MAX (CONFIG_BT_MESH_TX_SEG_MAX * 12 - BT_MESH_MIC_SHORT - 3)
+
+/* Provisioner handover, device key security only, never bound to an app key */
+#define VND_MODEL_ID_HANDOVER   0x0001
+
+#define VND_OP_HANDOVER_START   VND_OP(0x01)
+#define VND_OP_HANDOVER_NODE    VND_OP(0x02)
+#define VND_OP_HANDOVER_COMMIT  VND_OP(0x03)
+#define VND_OP_HANDOVER_ACK     VND_OP(0x04)
+
+/* Batched peer sightings, app key */
+#define VND_MODEL_ID_SIGHTINGS  0x0002
+
+#define VND_OP_SIGHTINGS_STATUS VND_OP(0x05)
+
+/* Remote peer table query, app key. The server runs on every device, the
+ * client pulls from it.
+ */
+#define VND_MODEL_ID_PEER_QUERY_SRV 0x0003
+#define VND_MODEL_ID_PEER_QUERY_CLI 0x0004
+
+#define VND_OP_PEER_QUERY_GET    VND_OP(0x06)
+#define VND_OP_PEER_QUERY_STATUS VND_OP(0x07)
+
+#endif /* __MESH_VND_H__ */
@@ -1,7 +1,7 @@
 #ifndef __MESH_NODE_H__
 #define __MESH_NODE_H__
 
-extern const struct bt_mesh_comp node_mesh_comp;
+/* Node callbacks, forwarded by the role's bt_mesh_prov */
 extern const struct bt_mesh_prov node_prov;
 
 int node_start(void);
@@ -0,0 +1,42 @@
+#ifndef __NODE_CONFIG_H__
+#define __NODE_CONFIG_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/mesh.h>
+
+#include "comp_cache.h"
+
+/* Asynchronous node configuration. Every node gets the app key added, its
+ * composition data fetched and all its models bound. The provisioner's own
+ * node also gets its sightings model subscribed to CONFIG_BL_SIGHTINGS_GROUP.
+ * Requests of several nodes are pipelined, with at most
+ * CONFIG_BL_MESH_CFG_MAX_INFLIGHT outstanding at any time, each with its own
+ * timeout and retries.
+ */
+
+/* Called from the configuration queue, err is 0 on success */
+typedef void (*node_config_done_t)(uint16_t addr, int err);
+
+/* Must be set as the callbacks of the Configuration Client instance */
+extern const struct bt_mesh_cfg_cli_cb node_config_cli_cb;
+
+int node_config_init(struct k_work_q *queue, uint16_t net_idx, uint16_t app_idx,
+		     node_config_done_t done);
+
+/* Returns -EALREADY if the node is already being configured, -ENOMEM if
+ * all job slots are taken. If product is given and cached, its bind list is
+ * used without fetching the composition data; a bind rejected as an
+ * invalid model falls back to the fetch.
+ */
+int node_config_add(uint16_t addr, const struct comp_cache_key *product);
+size_t node_config_pending(void);
+
+/* Drops the sightings group subscription of this device when it stops being
+ * the provisioner. Not retried, the status is not waited for.
+ */
+int node_config_sightings_leave(void);
+
+#endif /* __NODE_CONFIG_H__ */
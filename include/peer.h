@@ -11,19 +11,66 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
+
 #include <zephyr/kernel.h>
 #include <zephyr/bluetooth/addr.h>
-#include <math.h>
+#include <zephyr/sys/byteorder.h>
+
+#define SUPPORT_PEER_CODE         0xAABBDDFF
+
+/* Manufacturer data payload every peer advertises, little endian */
+struct adv_mfg_data {
+	uint16_t company_code;
+	uint32_t support_peer_code;
+	uint64_t hw_id;
+} __packed;
 
+/* Copy of a peer handed out by the peer table, which stores its fields
+ * in separate arrays.
+ */
 struct peer_entry {
-	sys_snode_t node;
 	bt_addr_le_t bt_addr;
 	uint64_t hw_id;
+	uint32_t last_seen_ms;
 	uint16_t timeout_ms;
+	/* Smoothed RSSI in dBm, Q8.8 fixed point */
+	int16_t rssi_q8;
 };
 
+#define PEER_RSSI_Q8_TO_DBM(q8) ((int8_t)((q8) >> 8))
+
+/* Everything that does not need Bluetooth, run while the controller boots */
+int peer_prepare(void);
 int peer_start();
 
+/* Peer advertising interval in units of 0.625 ms, for both the connectable
+ * and the non-connectable parameters. System work queue only.
+ */
+int peer_adv_interval_set(uint16_t min, uint16_t max);
+
+/* True if the manufacturer data payload is one of our peers'. The
+ * dispatcher hands over the payload in place. A peer payload has a fixed
+ * size and starts with our company code and SUPPORT_PEER_CODE, so anything
+ * else is rejected with one length check and two compares, without copies.
+ */
+static inline bool peer_mfg_match(const uint8_t *data, uint8_t len, uint64_t *hw_id)
+{
+	if (len != sizeof(struct adv_mfg_data)) {
+		return false;
+	}
+
+	if (sys_get_le16(&data[offsetof(struct adv_mfg_data, company_code)]) !=
+		    CONFIG_BT_COMPANY_ID_NORDIC ||
+	    sys_get_le32(&data[offsetof(struct adv_mfg_data, support_peer_code)]) !=
+		    SUPPORT_PEER_CODE) {
+		return false;
+	}
+
+	*hw_id = sys_get_le64(&data[offsetof(struct adv_mfg_data, hw_id)]);
+	return true;
+}
+
 
 #ifdef __cplusplus
 }
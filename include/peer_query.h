@@ -0,0 +1,88 @@
+#ifndef __PEER_QUERY_H__
+#define __PEER_QUERY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <zephyr/bluetooth/mesh.h>
+
+/* Remote peer table query, a client/server vendor model pair. The server
+ * numbers every change of its peer set (add, remove, RSSI moved by
+ * CONFIG_BL_PEER_QUERY_RSSI_DELTA) with a generation. The client sends the
+ * generation it already holds and gets back only the changes made since,
+ * in generation order, with peers named by a small varint packed id. The
+ * full hw_id is only sent when a peer is added. An unchanged neighbourhood
+ * costs one unsegmented status message.
+ *
+ * A client without a generation the server still knows gets the full table
+ * instead, paged by id with a cursor, followed by the deltas since the
+ * generation the transfer started at. Generations count within an epoch,
+ * a random nonce the server picks at boot, so a client that still holds a
+ * generation of an earlier boot gets the full table too.
+ *
+ * Get parameters:
+ *   le32 epoch, varint gen, [u8 cursor of a full transfer]
+ * Status parameters:
+ *   le32 epoch, varint gen, u8 flags (reset, full, more), records
+ *   record: varint (id << 2 | kind), then
+ *     ADDED:   le64 hw_id, i8 rssi
+ *     CHANGED: i8 rssi
+ *     REMOVED: nothing
+ */
+
+enum peer_query_kind {
+	/* The node's table is resent in full, drop what is known of it */
+	PEER_QUERY_RESET,
+	PEER_QUERY_ADDED,
+	PEER_QUERY_CHANGED,
+	PEER_QUERY_REMOVED,
+	/* The mirror of the node's table is up to date */
+	PEER_QUERY_SYNCED,
+};
+
+struct peer_query_change {
+	enum peer_query_kind kind;
+	uint64_t hw_id;
+	int8_t rssi;
+};
+
+struct peer_query_stats {
+	/* Server, full counts the transfers started */
+	uint32_t responses;
+	uint32_t unsegmented;
+	uint32_t full;
+	/* Client */
+	uint32_t requests;
+	uint32_t changes;
+	uint32_t status_bytes;
+};
+
+/* Called from the mesh RX thread for every change of a remote table */
+typedef void (*peer_query_cb_t)(uint16_t addr, const struct peer_query_change *change);
+
+/* For the vendor model entries of the composition */
+extern const struct bt_mesh_model_op peer_query_srv_ops[];
+extern const struct bt_mesh_model_cb peer_query_srv_cb;
+extern const struct bt_mesh_model_op peer_query_cli_ops[];
+extern const struct bt_mesh_model_cb peer_query_cli_cb;
+
+/* Asks the node at addr for the changes since its last response. Changes
+ * are passed to the callback, a truncated response is followed up right
+ * away until PEER_QUERY_SYNCED.
+ */
+int peer_query_get(uint16_t addr);
+
+/* Queries the configured nodes of the CDB round robin, one per
+ * CONFIG_BL_PEER_QUERY_POLL_MS, while this device is the provisioner. The
+ * round covers at most CONFIG_BL_PEER_QUERY_MIRRORS nodes, the ones holding
+ * a mirror, the other nodes are only heard through their sightings.
+ */
+int peer_query_poll_start(void);
+
+/* Forgets the mirror of addr, the next query fetches the full table */
+void peer_query_forget(uint16_t addr);
+
+void peer_query_cb_set(peer_query_cb_t cb);
+void peer_query_stats_get(struct peer_query_stats *stats);
+
+#endif /* __PEER_QUERY_H__ */
@@ -0,0 +1,21 @@
+#ifndef __PEER_STORE_H__
+#define __PEER_STORE_H__
+
+/* Snapshot of the nearest peers in the settings storage (NVS), so a reboot
+ * starts with a warm peer table instead of an empty one. The snapshot is
+ * taken every CONFIG_BL_PEER_STORE_INTERVAL_MS and only written when the
+ * set of peers changed, which keeps flash wear to a few writes per hour.
+ * Restored peers age out like any other if they are not seen again.
+ *
+ * Does nothing without CONFIG_SETTINGS.
+ */
+
+/* Call after peer_table_init(). Restores the snapshot if settings were
+ * already loaded, otherwise when they are.
+ */
+int peer_store_start(void);
+
+/* Writes the snapshot now if it changed, e.g. before a planned reset */
+int peer_store_flush(void);
+
+#endif /* __PEER_STORE_H__ */
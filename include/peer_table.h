@@ -0,0 +1,35 @@
+#ifndef __PEER_TABLE_H__
+#define __PEER_TABLE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "peer.h"
+
+/* Return true to continue iterating, false to stop */
+typedef bool (*peer_table_cb_t)(const struct peer_entry *entry, void *user_data);
+
+int peer_table_init(void);
+
+/* Insert or refresh a peer and fold rssi into its moving average. Returns 1
+ * if the peer is new, 0 if it was refreshed.
+ */
+int peer_table_update(const bt_addr_le_t *addr, uint64_t hw_id, int8_t rssi);
+
+bool peer_table_get(uint64_t hw_id, struct peer_entry *entry);
+size_t peer_table_count(void);
+
+/* Copies the up to n peers with the strongest smoothed RSSI into out,
+ * strongest first. One pass over the peers with a bounded heap,
+ * O(count log n). n is capped to CONFIG_BL_PEER_NEAREST_MAX.
+ */
+size_t peer_table_nearest(struct peer_entry *out, size_t n);
+
+/* Entries are copied out before calling cb, so cb may block. Peers are
+ * stored densely and removals move the last one down, so a peer aging out
+ * meanwhile can make the walk skip or repeat an entry.
+ */
+void peer_table_foreach(peer_table_cb_t cb, void *user_data);
+
+#endif /* __PEER_TABLE_H__ */
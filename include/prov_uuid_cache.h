@@ -0,0 +1,15 @@
+#ifndef __PROV_UUID_CACHE_H__
+#define __PROV_UUID_CACHE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Remembers the outcome of provisioning attempts per device UUID. Known
+ * devices are suppressed, failed devices back off exponentially with jitter.
+ */
+
+/* False if the device is already provisioned or still backing off */
+bool prov_uuid_cache_allowed(const uint8_t uuid[16]);
+void prov_uuid_cache_record(const uint8_t uuid[16], bool success);
+
+#endif /* __PROV_UUID_CACHE_H__ */
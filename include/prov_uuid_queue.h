@@ -0,0 +1,19 @@
+#ifndef __PROV_UUID_QUEUE_H__
+#define __PROV_UUID_QUEUE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Bounded FIFO of unprovisioned device UUIDs waiting to be provisioned.
+ * Fed from the unprovisioned beacon callback, drained by the provisioning
+ * work queue.
+ */
+
+/* Returns 0 if queued, -EALREADY if the UUID is already queued, -ENOMEM if full */
+int prov_uuid_queue_push(const uint8_t uuid[16]);
+bool prov_uuid_queue_pop(uint8_t uuid[16]);
+size_t prov_uuid_queue_count(void);
+void prov_uuid_queue_clear(void);
+
+#endif /* __PROV_UUID_QUEUE_H__ */
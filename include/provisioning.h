@@ -1,10 +1,21 @@
 #ifndef __MESH_PROVISIONING_H__
 #define __MESH_PROVISIONING_H__
 
-extern const struct bt_mesh_comp provisioner_mesh_comp;
+#include <zephyr/kernel.h>
+
+/* Provisioner callbacks, forwarded by the role's bt_mesh_prov */
 extern const struct bt_mesh_prov provisioner_prov;
 
-int provisining_init(void);
+/* Creates or loads the CDB, provisions this device and starts provisioning */
 int provisioning_start(void);
 
-#endif /* __MESH_PROVISIONING_H__ */
\ No newline at end of file
+/* Starts provisioning with a CDB imported from another provisioner */
+int provisioning_takeover(void);
+
+/* From the system work queue only. Stops starting new attempts, -EBUSY if
+ * a device is being provisioned right now.
+ */
+int provisioning_pause(void);
+void provisioning_resume(void);
+
+#endif /* __MESH_PROVISIONING_H__ */
@@ -0,0 +1,55 @@
+#ifndef __PROX_GRAPH_H__
+#define __PROX_GRAPH_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Proximity graph of the provisioner. Vertices are devices by hw_id, an
+ * undirected edge joins two devices that heard each other, with the RSSI
+ * filtered over the reports of both ends and the time it was last heard.
+ * Fed from the sightings nodes publish and from peer queries, only while
+ * this device is the provisioner. Reporters are resolved to their hw_id
+ * through the CDB, reports of unknown addresses are dropped.
+ *
+ * Memory is fixed at CONFIG_BL_PROX_VERTICES and CONFIG_BL_PROX_EDGES,
+ * reports that need more are dropped until edges age out. The arrays are
+ * static, see fake_kconfig.h for the cost. Builds without
+ * CONFIG_BL_PROVISIONER keep one entry of each and never start the graph.
+ */
+
+struct prox_neighbour {
+	uint64_t hw_id;
+	/* Unicast address if the device reported itself, else unassigned */
+	uint16_t addr;
+	int8_t rssi;
+	uint32_t age_ms;
+};
+
+struct prox_graph_stats {
+	uint32_t vertices;
+	uint32_t edges;
+	uint32_t aged_out;
+	/* Reports dropped for lack of a vertex or an edge */
+	uint32_t dropped;
+};
+
+/* Registers for sightings and peer query changes, starts aging */
+int prox_graph_start(void);
+
+/* reporter at addr heard hw_id age_ms ago */
+int prox_graph_update(uint16_t addr, uint64_t hw_id, int8_t rssi, uint32_t age_ms);
+void prox_graph_remove(uint16_t addr, uint64_t hw_id);
+
+/* Copies up to n neighbours of hw_id into out, in no particular order.
+ * O(degree).
+ */
+size_t prox_graph_neighbours(uint64_t hw_id, struct prox_neighbour *out, size_t n);
+
+/* Copies up to n neighbours of hw_id with the strongest RSSI into out,
+ * strongest first. n is capped to CONFIG_BL_PROX_NEAREST_MAX.
+ */
+size_t prox_graph_nearest(uint64_t hw_id, struct prox_neighbour *out, size_t n);
+
+void prox_graph_stats_get(struct prox_graph_stats *stats);
+
+#endif /* __PROX_GRAPH_H__ */
@@ -0,0 +1,40 @@
+#ifndef __ROLE_H__
+#define __ROLE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <zephyr/bluetooth/mesh.h>
+
+/* Provisioner and node share one composition (Configuration Server and
+ * Client, the vendor models of mesh_vnd.h) and one set of provisioning callbacks, so the
+ * role can change without a reboot. The provisioner hands its CDB over
+ * to a node with device key secured messages; once the node confirms it
+ * has it all, the node carries on provisioning and the old provisioner
+ * clears its CDB and stays a plain node. The role is stored in settings
+ * and wins over the provisioner button on the next boot.
+ */
+
+extern const struct bt_mesh_comp mesh_comp;
+extern const struct bt_mesh_prov mesh_prov;
+
+/* Before bt_mesh_init. A role stored by an earlier handover, restored by
+ * settings_load, wins over the given one.
+ */
+int role_init(bool provisioner);
+bool role_is_provisioner(void);
+
+/* After settings_load, starts the provisioner or the node */
+int role_start(void);
+
+/* Provisioner only. Hands the CDB over to the node at addr. -EBUSY if a
+ * handover is already running.
+ */
+int role_handover(uint16_t addr);
+
+/* Hands over to the configured node among the nearest peers, -ENOENT if
+ * none of them is in the CDB.
+ */
+int role_handover_nearest(void);
+
+#endif /* __ROLE_H__ */
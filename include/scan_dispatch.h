@@ -0,0 +1,54 @@
+#ifndef __SCAN_DISPATCH_H__
+#define __SCAN_DISPATCH_H__
+
+#include <stdint.h>
+
+#include <zephyr/sys/slist.h>
+#include <zephyr/bluetooth/bluetooth.h>
+
+/* Every scan report is sorted once into one of these classes by the AD
+ * type it carries. Mesh classes are counted here and consumed by the mesh
+ * stack through its own scan callback; the dispatcher never restarts the
+ * scanner mesh is using.
+ */
+enum scan_class {
+	SCAN_CLASS_MESH_MSG,
+	SCAN_CLASS_MESH_BEACON,
+	SCAN_CLASS_MESH_PROV,
+	SCAN_CLASS_MFG,
+	SCAN_CLASS_OTHER,
+
+	SCAN_CLASS_COUNT,
+};
+
+struct scan_report {
+	const struct bt_le_scan_recv_info *info;
+	/* Payload of the AD structure that classified the report, type excluded */
+	const uint8_t *data;
+	uint8_t data_len;
+};
+
+struct scan_consumer {
+	sys_snode_t node;
+	/* Bitmask of BIT(enum scan_class) the consumer wants */
+	uint32_t class_mask;
+	/* Called from the Bluetooth RX thread, must not block */
+	void (*recv)(enum scan_class cls, const struct scan_report *report);
+};
+
+/* Sorts an advertising payload, report->data points at the payload of the
+ * AD structure that decided. Exposed for tests/scan_parse.
+ */
+enum scan_class scan_classify(const struct net_buf_simple *buf, struct scan_report *report);
+
+/* The scan listener, classifies and counts a report and hands it to the
+ * consumers that want its class. Exposed for tests/scan_parse.
+ */
+void scan_dispatch_recv(const struct bt_le_scan_recv_info *info, struct net_buf_simple *buf);
+
+int scan_dispatch_register(struct scan_consumer *consumer);
+int scan_dispatch_start(void);
+
+void scan_dispatch_counts_get(uint32_t counts[SCAN_CLASS_COUNT]);
+
+#endif /* __SCAN_DISPATCH_H__ */
@@ -0,0 +1,38 @@
+#ifndef __SCAN_SCHED_H__
+#define __SCAN_SCHED_H__
+
+#include <stdint.h>
+
+/* Duty cycle mode picked from how much this device needs to be heard:
+ * provisioning traffic and new peers around, mesh traffic heard, and
+ * whether it is provisioned yet. Mesh owns the scanner, the mode sets the
+ * peer advertising interval, which only affects how fast others find us.
+ * Goes up immediately, comes down only after the need has stayed low for
+ * CONFIG_BL_SCAN_SCHED_HOLD_MS.
+ */
+enum scan_mode {
+	/* Fastest advertising, while provisioning or new peers show up */
+	SCAN_MODE_DISCOVERY,
+	/* Busy mesh, or this device is not provisioned yet */
+	SCAN_MODE_TRACKING,
+	/* Stable neighbourhood */
+	SCAN_MODE_RELAXED,
+
+	SCAN_MODE_COUNT,
+};
+
+struct scan_sched_stats {
+	enum scan_mode mode;
+	uint32_t switches;
+	/* Time spent in each mode, including the current one */
+	uint32_t mode_ms[SCAN_MODE_COUNT];
+};
+
+int scan_sched_start(void);
+
+/* Something new showed up, scan at full duty for a while. Any context */
+void scan_sched_kick(void);
+
+void scan_sched_stats_get(struct scan_sched_stats *stats);
+
+#endif /* __SCAN_SCHED_H__ */
@@ -0,0 +1,48 @@
+#ifndef __SIGHTING_PUB_H__
+#define __SIGHTING_PUB_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <zephyr/bluetooth/mesh.h>
+
+/* Sightings vendor model. Peers from the peer table are reported to
+ * CONFIG_BL_SIGHTINGS_GROUP, which only the provisioner subscribes to, in
+ * batches, as many as fit in one segmented message of
+ * CONFIG_BT_MESH_TX_SEG_MAX segments. A peer is only reported when it is
+ * new, its RSSI moved by CONFIG_BL_SIGHTINGS_RSSI_DELTA or its last report
+ * is older than CONFIG_BL_SIGHTINGS_REFRESH_MS. A batch goes out when it
+ * is full or its oldest entry waited CONFIG_BL_SIGHTINGS_MAX_DELAY_MS.
+ */
+
+struct sighting_report {
+	uint64_t hw_id;
+	int8_t rssi;
+	/* Time since the peer was last seen, in 100 ms units, saturated */
+	uint8_t age;
+};
+
+struct sighting_pub_stats {
+	/* Sightings reported and the messages they took */
+	uint32_t published;
+	uint32_t messages;
+	uint32_t send_failed;
+	/* Sightings received from other devices and our own loopback */
+	uint32_t received;
+};
+
+/* Called from the mesh RX thread for every received batch */
+typedef void (*sighting_pub_recv_t)(uint16_t src, const struct sighting_report *reports,
+				    size_t count);
+
+/* For the vendor model entry of the composition */
+extern const struct bt_mesh_model_op sighting_pub_ops[];
+extern const struct bt_mesh_model_cb sighting_pub_cb;
+
+/* After mesh and peer start */
+int sighting_pub_start(void);
+
+void sighting_pub_recv_set(sighting_pub_recv_t cb);
+void sighting_pub_stats_get(struct sighting_pub_stats *stats);
+
+#endif /* __SIGHTING_PUB_H__ */
@@ -0,0 +1,38 @@
+#ifndef __SIGHTING_RING_H__
+#define __SIGHTING_RING_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <zephyr/bluetooth/addr.h>
+
+/* Single producer (Bluetooth RX thread), single consumer (peer queue) ring
+ * of compact scan sightings. No locks, the producer owns the head and the
+ * consumer owns the tail.
+ */
+struct peer_sighting {
+	uint64_t hw_id;
+	uint32_t timestamp_ms;
+	bt_addr_le_t addr;
+	int8_t rssi;
+};
+
+struct sighting_ring_stats {
+	uint32_t pushed;
+	uint32_t dropped;
+	uint32_t high_water;
+	uint32_t drained;
+	uint32_t batches;
+};
+
+/* Producer side, never blocks. Returns false and counts a drop when full */
+bool sighting_ring_push(const struct peer_sighting *sighting);
+
+/* Consumer side, returns the number of sightings copied into out */
+size_t sighting_ring_pop_batch(struct peer_sighting *out, size_t max);
+bool sighting_ring_empty(void);
+
+void sighting_ring_stats_get(struct sighting_ring_stats *stats);
+
+#endif /* __SIGHTING_RING_H__ */
@@ -0,0 +1,61 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdint.h>
+
+#include <zephyr/sys/util_macro.h>
+
+#include "fake_kconfig.h"
+
+/* Binary event trace for hot paths. Each event is a fixed 16 byte record
+ * written to a RAM ring and drained in the background to RTT or a UART,
+ * without any formatting on the device. scripts/trace_decode.py turns the
+ * stream back into text.
+ *
+ * Event ids are part of the wire format, append new ones and keep the
+ * decoder table in sync.
+ */
+enum trace_event {
+	/* arg1 = cycles per second, sent once before the first record */
+	TRACE_EVT_CLOCK         = 0x0001,
+	/* arg1 = records overwritten since the last report */
+	TRACE_EVT_OVERRUN       = 0x0002,
+
+	/* arg0 = address type, arg1/arg2 = address bytes 0-3/4-5 */
+	TRACE_EVT_ADV_SCANNED   = 0x0100,
+	/* arg0 = rssi, arg1/arg2 = hw_id low/high */
+	TRACE_EVT_PEER_NEW      = 0x0200,
+	/* arg1/arg2 = UUID bytes 0-3/4-7 */
+	TRACE_EVT_PROV_START    = 0x0300,
+	/* arg0 = node address */
+	TRACE_EVT_PROV_ADDED    = 0x0301,
+	/* arg1 = negative errno, arg2 = UUID bytes 0-3 */
+	TRACE_EVT_PROV_FAILED   = 0x0302,
+};
+
+struct trace_record {
+	uint32_t timestamp;
+	uint16_t event;
+	uint16_t arg0;
+	uint32_t arg1;
+	uint32_t arg2;
+} __packed;
+
+/* Per module switch, compiles the call away when the module is off */
+#define TRACE(module, evt, a0, a1, a2)						\
+	do {									\
+		if (IS_ENABLED(CONFIG_BL_TRACE) &&				\
+		    IS_ENABLED(CONFIG_BL_TRACE_##module)) {			\
+			trace_event((evt), (a0), (a1), (a2));			\
+		}								\
+	} while (0)
+
+#define TRACE_ENABLED(module) \
+	(IS_ENABLED(CONFIG_BL_TRACE) && IS_ENABLED(CONFIG_BL_TRACE_##module))
+
+int trace_start(void);
+
+/* Any context, never blocks. The oldest record is overwritten when full */
+void trace_event(uint16_t event, uint16_t arg0, uint32_t arg1, uint32_t arg2);
+
+#endif /* __TRACE_H__ */
@@ -0,0 +1,114 @@
+#!/bin/sh
+# Runs N instances of the app in BabbleSim, device 0 as provisioner and the
+# others as nodes, then summarizes the last BENCH line of every device.
+#
+# Usage: scripts/bsim_run.sh <zephyr.exe> [devices] [seconds]
+#
+# Build with: west build -b nrf52_bsim
+# BSIM_OUT_PATH must point to the BabbleSim installation.
+
+set -e
+
+EXE=${1:?"usage: $0 <zephyr.exe> [devices] [seconds]"}
+DEVICES=${2:-16}
+SECONDS_SIM=${3:-120}
+SIM_ID=mesh_scan_coexist_$$
+LOG_DIR=${LOG_DIR:-bsim_logs}
+
+: "${BSIM_OUT_PATH:?BSIM_OUT_PATH is not set}"
+
+if [ "$DEVICES" -lt 2 ] || [ "$DEVICES" -gt 64 ]; then
+	echo "devices must be between 2 and 64" >&2
+	exit 1
+fi
+
+mkdir -p "$LOG_DIR"
+
+# The phy loads its channel and modem libraries relative to the working
+# directory, everything is run from the BabbleSim bin directory
+EXE=$(cd "$(dirname "$EXE")" && pwd)/$(basename "$EXE")
+LOG_DIR=$(cd "$LOG_DIR" && pwd)
+cd "$BSIM_OUT_PATH/bin"
+
+./bs_2G4_phy_v1 -s="$SIM_ID" -D="$DEVICES" \
+	-sim_length=$((SECONDS_SIM * 1000000)) > "$LOG_DIR/phy.log" 2>&1 &
+PHY_PID=$!
+
+PIDS=
+i=0
+while [ "$i" -lt "$DEVICES" ]; do
+	"$EXE" -s="$SIM_ID" -d="$i" -rs="$((i + 1))" > "$LOG_DIR/dev_$i.log" 2>&1 &
+	PIDS="$PIDS $!"
+	i=$((i + 1))
+done
+
+# A device that crashes must not cut the summary of the others short
+FAILED=
+i=0
+for pid in $PIDS; do
+	if ! wait "$pid"; then
+		FAILED="$FAILED $i"
+	fi
+	i=$((i + 1))
+done
+if ! wait "$PHY_PID"; then
+	echo "phy exited with an error, see $LOG_DIR/phy.log" >&2
+	FAILED="$FAILED phy"
+fi
+
+# Last report of each device
+for log in "$LOG_DIR"/dev_*.log; do
+	grep "BENCH " "$log" | tail -n 1
+done | awk -v devices="$DEVICES" '
+function val(key,    i, kv) {
+	for (i = 1; i <= NF; i++) {
+		split($i, kv, "=")
+		if (kv[1] == key) {
+			return kv[2]
+		}
+	}
+	return -1
+}
+{
+	if (val("role") == "prov") {
+		configured = val("configured")
+		configured_ms = val("configured_ms")
+	} else if (val("provisioned") >= 0) {
+		provisioned++
+		if (val("provisioned") > provisioned_ms) {
+			provisioned_ms = val("provisioned")
+		}
+	}
+	discovered += val("discovered")
+	discovery_sum += val("discovered") * val("discovery_mean_ms")
+	if (val("discovery_max_ms") > discovery_max) {
+		discovery_max = val("discovery_max_ms")
+	}
+	hits += val("mfg_hits")
+	mfg += val("mfg_reports")
+	saturated += val("relay_saturated")
+	dropped += val("relay_dropped")
+	sightings_sent += val("sightings_sent")
+	sighting_msgs += val("sighting_msgs")
+	if (val("operational_us") > operational_max) {
+		operational_max = val("operational_us")
+	}
+}
+END {
+	printf "devices:              %d\n", devices
+	printf "boot to operational:  max %d us\n", operational_max
+	printf "provisioned nodes:    %d/%d, last at %d ms\n", provisioned, devices - 1, provisioned_ms
+	printf "configured nodes:     %d, last at %d ms\n", configured, configured_ms
+	printf "peer discovery:       %d sightings, mean %d ms, max %d ms\n",
+		discovered, discovered ? discovery_sum / discovered : 0, discovery_max
+	printf "filter hit rate:      %d/%d (%.1f%%)\n", hits, mfg, mfg ? 100 * hits / mfg : 0
+	printf "relay saturated:      ~%d samples (estimated from the mesh statistics)\n", saturated
+	printf "relay dropped:        %d messages\n", dropped
+	printf "sighting reports:     %d in %d messages (%.1f per message)\n",
+		sightings_sent, sighting_msgs, sighting_msgs ? sightings_sent / sighting_msgs : 0
+}'
+
+if [ -n "$FAILED" ]; then
+	echo "exited with an error:$FAILED, see $LOG_DIR" >&2
+	exit 1
+fi
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+# Decodes the binary event trace written by src/trace.c.
+#
+# Usage: scripts/trace_decode.py [capture.bin] [--hz HZ]
+#
+# The capture is the raw RTT up channel or UART stream, read from stdin when
+# no file is given. Frames start with 0xA5 0x5A followed by a 16 byte little
+# endian record; the decoder resyncs on the marker after garbage.
+
+import argparse
+import struct
+import sys
+
+SYNC = b'\xa5\x5a'
+RECORD = struct.Struct('<IHHII')
+
+# Keep in sync with enum trace_event in include/trace.h
+EVT_CLOCK = 0x0001
+EVT_OVERRUN = 0x0002
+EVT_ADV_SCANNED = 0x0100
+EVT_PEER_NEW = 0x0200
+EVT_PROV_START = 0x0300
+EVT_PROV_ADDED = 0x0301
+EVT_PROV_FAILED = 0x0302
+
+
+def fmt_addr(a0, a1, a2):
+    raw = struct.pack('<IH', a1, a2 & 0xffff)
+    kind = 'random' if a0 else 'public'
+    return '%s (%s)' % (':'.join('%02X' % b for b in reversed(raw)), kind)
+
+
+def s32(v):
+    return v - (1 << 32) if v & 0x80000000 else v
+
+
+def s16(v):
+    return v - (1 << 16) if v & 0x8000 else v
+
+
+FORMATS = {
+    EVT_CLOCK: ('clock', lambda a0, a1, a2: '%u Hz' % a1),
+    EVT_OVERRUN: ('overrun', lambda a0, a1, a2: '%u records lost' % a1),
+    EVT_ADV_SCANNED: ('adv_scanned', lambda a0, a1, a2: 'by %s' % fmt_addr(a0, a1, a2)),
+    EVT_PEER_NEW: ('peer_new', lambda a0, a1, a2: 'hw_id %u rssi %d' % ((a2 << 32) | a1, s16(a0))),
+    EVT_PROV_START: ('prov_start', lambda a0, a1, a2: 'uuid %s' % struct.pack('<II', a1, a2).hex()),
+    EVT_PROV_ADDED: ('prov_added', lambda a0, a1, a2: 'node 0x%04x' % a0),
+    EVT_PROV_FAILED: ('prov_failed', lambda a0, a1, a2: 'uuid %s err %d' %
+                      (struct.pack('<I', a2).hex(), s32(a1))),
+}
+
+
+def records(data):
+    pos = 0
+    skipped = 0
+    while True:
+        found = data.find(SYNC, pos)
+        if found < 0 or found + len(SYNC) + RECORD.size > len(data):
+            break
+        skipped += found - pos
+        pos = found + len(SYNC)
+        yield skipped, RECORD.unpack_from(data, pos)
+        pos += RECORD.size
+        skipped = 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode the binary event trace')
+    parser.add_argument('capture', nargs='?', help='raw capture, stdin if omitted')
+    parser.add_argument('--hz', type=int, default=32768,
+                        help='cycle counter rate until a clock record is seen (default 32768)')
+    args = parser.parse_args()
+
+    if args.capture:
+        with open(args.capture, 'rb') as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+
+    hz = args.hz
+    base = None
+    for skipped, (timestamp, event, a0, a1, a2) in records(data):
+        if skipped:
+            print('# skipped %d bytes' % skipped)
+        if event == EVT_CLOCK:
+            hz = a1 or hz
+        if base is None:
+            base = timestamp
+
+        # The 32 bit cycle counter wraps, times are relative to the first record
+        seconds = ((timestamp - base) & 0xffffffff) / hz
+        name, fmt = FORMATS.get(event, ('0x%04x' % event,
+                                        lambda a0, a1, a2: '%u %u %u' % (a0, a1, a2)))
+        print('[%12.6f] %-12s %s' % (seconds, name, fmt(a0, a1, a2)))
+
+
+if __name__ == '__main__':
+    main()
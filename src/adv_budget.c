@@ -0,0 +1,166 @@
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(adv_budget, LOG_LEVEL_DBG);
+
+#include "fake_kconfig.h"
+
+#include "adv_budget.h"
+
+/* Mesh advertiser, its relay sets and the optional separate GATT and
+ * friend sets, as counted by mesh's extended advertiser
+ */
+#define MESH_ADV_SETS (1 + CONFIG_BT_MESH_RELAY_ADV_SETS + \
+		       IS_ENABLED(CONFIG_BT_MESH_ADV_EXT_GATT_SEPARATE) + \
+		       IS_ENABLED(CONFIG_BT_MESH_ADV_EXT_FRIEND_SEPARATE))
+#define APP_ADV_SETS  (CONFIG_BT_EXT_ADV_MAX_ADV_SET - MESH_ADV_SETS)
+
+BUILD_ASSERT(!IS_ENABLED(CONFIG_BT_MESH) || APP_ADV_SETS > 0,
+	     "Mesh takes every advertising set, none is left for the application");
+
+struct app_set {
+	struct bt_le_ext_adv *adv;
+	enum adv_budget_prio prio;
+	adv_budget_preempted_t preempted;
+};
+
+static struct app_set sets[IS_ENABLED(CONFIG_BT_MESH) ? APP_ADV_SETS :
+			   CONFIG_BT_EXT_ADV_MAX_ADV_SET];
+static K_MUTEX_DEFINE(budget_lock);
+static uint32_t denied;
+static uint32_t preempted;
+
+int adv_budget_start(void)
+{
+	if (IS_ENABLED(CONFIG_BT_MESH)) {
+		LOG_DBG("%u advertising sets, %u reserved for mesh",
+			CONFIG_BT_EXT_ADV_MAX_ADV_SET, MESH_ADV_SETS);
+	}
+
+	return 0;
+}
+
+/* Lowest priority preemptible set below prio, the first of equals */
+static struct app_set *set_victim(enum adv_budget_prio prio)
+{
+	struct app_set *victim = NULL;
+
+	for (size_t i = 0; i < ARRAY_SIZE(sets); i++) {
+		if (sets[i].adv && sets[i].preempted && sets[i].prio < prio &&
+		    (!victim || sets[i].prio < victim->prio)) {
+			victim = &sets[i];
+		}
+	}
+
+	return victim;
+}
+
+static int set_preempt(struct app_set *set)
+{
+	struct bt_le_ext_adv *adv = set->adv;
+	int err;
+
+	err = bt_le_ext_adv_stop(adv);
+	if (err) {
+		return err;
+	}
+
+	err = bt_le_ext_adv_delete(adv);
+	if (err) {
+		return err;
+	}
+
+	set->adv = NULL;
+	preempted++;
+	LOG_DBG("Preempted advertising set of priority %d", set->prio);
+	set->preempted(adv);
+
+	return 0;
+}
+
+int adv_budget_create(const struct bt_le_adv_param *param, const struct bt_le_ext_adv_cb *cb,
+		      enum adv_budget_prio prio, adv_budget_preempted_t preempted_cb,
+		      struct bt_le_ext_adv **adv)
+{
+	struct app_set *set = NULL;
+	int err;
+
+	k_mutex_lock(&budget_lock, K_FOREVER);
+
+	for (size_t i = 0; i < ARRAY_SIZE(sets); i++) {
+		if (!sets[i].adv) {
+			set = &sets[i];
+			break;
+		}
+	}
+
+	if (!set) {
+		set = set_victim(prio);
+		if (set) {
+			err = set_preempt(set);
+			if (err) {
+				LOG_ERR("Failed to preempt advertising set (err %d)", err);
+				set = NULL;
+			}
+		}
+	}
+
+	if (!set) {
+		denied++;
+		k_mutex_unlock(&budget_lock);
+		return -ENOMEM;
+	}
+
+	err = bt_le_ext_adv_create(param, cb, &set->adv);
+	if (err) {
+		set->adv = NULL;
+	} else {
+		set->prio = prio;
+		set->preempted = preempted_cb;
+		*adv = set->adv;
+	}
+
+	k_mutex_unlock(&budget_lock);
+
+	return err;
+}
+
+int adv_budget_delete(struct bt_le_ext_adv *adv)
+{
+	int err = -ENOENT;
+
+	k_mutex_lock(&budget_lock, K_FOREVER);
+
+	for (size_t i = 0; i < ARRAY_SIZE(sets); i++) {
+		if (sets[i].adv == adv) {
+			err = bt_le_ext_adv_delete(adv);
+			if (!err) {
+				sets[i].adv = NULL;
+			}
+			break;
+		}
+	}
+
+	k_mutex_unlock(&budget_lock);
+
+	return err;
+}
+
+void adv_budget_stats_get(struct adv_budget_stats *stats)
+{
+	*stats = (struct adv_budget_stats) {
+		.total = CONFIG_BT_EXT_ADV_MAX_ADV_SET,
+		.mesh = IS_ENABLED(CONFIG_BT_MESH) ? MESH_ADV_SETS : 0,
+	};
+
+	k_mutex_lock(&budget_lock, K_FOREVER);
+
+	for (size_t i = 0; i < ARRAY_SIZE(sets); i++) {
+		stats->app += !!sets[i].adv;
+	}
+	stats->denied = denied;
+	stats->preempted = preempted;
+
+	k_mutex_unlock(&budget_lock);
+}
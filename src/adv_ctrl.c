@@ -0,0 +1,179 @@
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/bluetooth/bluetooth.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(adv_ctrl, LOG_LEVEL_DBG);
+
+#include "adv_budget.h"
+#include "adv_ctrl.h"
+
+static struct bt_le_ext_adv *adv;
+static const struct bt_le_ext_adv_cb *user_cb;
+static const struct bt_data *adv_ad;
+static size_t adv_ad_len;
+static const struct bt_data *adv_sd;
+static size_t adv_sd_len;
+
+/* A connection made through the set stops it in the controller, the gap
+ * starts there rather than at our own stop.
+ */
+static atomic_t conn_stopped;
+static atomic_t conn_stopped_cyc;
+
+static struct adv_ctrl_stats stats;
+static struct k_spinlock stats_lock;
+
+static void ctrl_connected(struct bt_le_ext_adv *set, struct bt_le_ext_adv_connected_info *info)
+{
+	atomic_set(&conn_stopped_cyc, k_cycle_get_32());
+	atomic_set(&conn_stopped, 1);
+
+	if (user_cb && user_cb->connected) {
+		user_cb->connected(set, info);
+	}
+}
+
+static void ctrl_scanned(struct bt_le_ext_adv *set, struct bt_le_ext_adv_scanned_info *info)
+{
+	if (user_cb && user_cb->scanned) {
+		user_cb->scanned(set, info);
+	}
+}
+
+static const struct bt_le_ext_adv_cb ctrl_cb = {
+	.connected = ctrl_connected,
+	.scanned = ctrl_scanned,
+};
+
+static int set_create(const struct bt_le_adv_param *param)
+{
+	int err;
+
+	/* The peer advertising is what the application is for, never preempted */
+	err = adv_budget_create(param, &ctrl_cb, ADV_BUDGET_PRIO_HIGH, NULL, &adv);
+	if (err) {
+		LOG_ERR("Failed to create advertising set (err %d)", err);
+		return err;
+	}
+
+	err = bt_le_ext_adv_set_data(adv, adv_ad, adv_ad_len, adv_sd, adv_sd_len);
+	if (err) {
+		LOG_ERR("Failed setting adv data (err %d)", err);
+		return err;
+	}
+
+	return 0;
+}
+
+static int set_enable(void)
+{
+	struct bt_le_ext_adv_start_param start_param = { 0 };
+
+	int err = bt_le_ext_adv_start(adv, &start_param);
+	if (err) {
+		LOG_ERR("Failed to start extended advertising (err %d)", err);
+	}
+
+	return err;
+}
+
+int adv_ctrl_start(const struct bt_le_adv_param *param, const struct bt_le_ext_adv_cb *cb,
+		   const struct bt_data *ad, size_t ad_len,
+		   const struct bt_data *sd, size_t sd_len)
+{
+	int err;
+
+	if (adv) {
+		return -EALREADY;
+	}
+
+	user_cb = cb;
+	adv_ad = ad;
+	adv_ad_len = ad_len;
+	adv_sd = sd;
+	adv_sd_len = sd_len;
+
+	err = set_create(param);
+	if (err) {
+		return err;
+	}
+
+	return set_enable();
+}
+
+int adv_ctrl_param_set(const struct bt_le_adv_param *param)
+{
+	uint32_t gap_start = k_cycle_get_32();
+	bool recreated = false;
+	int err;
+
+	if (!adv) {
+		return -ENODEV;
+	}
+
+	if (atomic_cas(&conn_stopped, 1, 0)) {
+		gap_start = atomic_get(&conn_stopped_cyc);
+	}
+
+	/* Parameters can only be changed while the set is disabled */
+	err = bt_le_ext_adv_stop(adv);
+	if (err) {
+		LOG_ERR("Failed to stop extended advertising (err %d)", err);
+		return err;
+	}
+
+	err = bt_le_ext_adv_update_param(adv, param);
+	if (err) {
+		LOG_WRN("In-place parameter update failed (err %d), recreating the set", err);
+
+		err = adv_budget_delete(adv);
+		if (err) {
+			LOG_ERR("Failed to delete advertising set (err %d)", err);
+			return err;
+		}
+		adv = NULL;
+
+		err = set_create(param);
+		recreated = true;
+	} else {
+		/* Scan response data depends on the scannable option */
+		err = bt_le_ext_adv_set_data(adv, adv_ad, adv_ad_len, adv_sd, adv_sd_len);
+		if (err) {
+			LOG_ERR("Failed setting adv data (err %d)", err);
+		}
+	}
+	if (err) {
+		return err;
+	}
+
+	err = set_enable();
+	if (err) {
+		return err;
+	}
+
+	uint32_t gap_us = k_cyc_to_us_floor32(k_cycle_get_32() - gap_start);
+
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	stats.switches++;
+	stats.recreates += recreated;
+	stats.gap_last_us = gap_us;
+	stats.gap_max_us = MAX(stats.gap_max_us, gap_us);
+	stats.gap_total_us += gap_us;
+
+	k_spin_unlock(&stats_lock, key);
+
+	LOG_DBG("Advertising parameters switched, %u us without advertising", gap_us);
+
+	return 0;
+}
+
+void adv_ctrl_stats_get(struct adv_ctrl_stats *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	*out = stats;
+
+	k_spin_unlock(&stats_lock, key);
+}
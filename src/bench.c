@@ -0,0 +1,128 @@
+#include <zephyr/kernel.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(bench, LOG_LEVEL_DBG);
+
+#include "fake_kconfig.h"
+
+#include "bench.h"
+#include "boot.h"
+#include "hw_config.h"
+#include "mesh_stats.h"
+#include "peer_table.h"
+#include "scan_dispatch.h"
+#include "sighting_ring.h"
+#include "sighting_pub.h"
+
+static bool is_provisioner;
+static atomic_t provisioned_ms = ATOMIC_INIT(-1);
+static atomic_t configured;
+static atomic_t configured_last_ms;
+static atomic_t discovered;
+static atomic_t discovery_sum_ms;
+static atomic_t discovery_max_ms;
+static uint64_t seen[CONFIG_BL_BENCH_PEERS];
+static size_t seen_count;
+static struct k_spinlock seen_lock;
+
+static void report_work_handle(struct k_work *item);
+static K_WORK_DELAYABLE_DEFINE(report_work, report_work_handle);
+
+/* One line per period, key=value so that the run script can parse it */
+static void report_work_handle(struct k_work *item)
+{
+	uint32_t counts[SCAN_CLASS_COUNT];
+	struct sighting_ring_stats ring;
+	struct sighting_pub_stats pub;
+	struct mesh_stats mesh = { 0 };
+	uint32_t reports = 0;
+	uint32_t found = atomic_get(&discovered);
+
+	scan_dispatch_counts_get(counts);
+	for (int i = 0; i < SCAN_CLASS_COUNT; i++) {
+		reports += counts[i];
+	}
+	sighting_ring_stats_get(&ring);
+	mesh_stats_get(&mesh);
+	sighting_pub_stats_get(&pub);
+
+	LOG_INF("BENCH dev=%016llx role=%s t=%u operational_us=%d provisioned=%d "
+		"configured=%d configured_ms=%d "
+		"peers=%zu discovered=%u discovery_mean_ms=%u discovery_max_ms=%d "
+		"mfg_hits=%u mfg_reports=%u reports=%u relay_saturated=%u relay_high_water=%u "
+		"relay_dropped=%u "
+		"sightings_sent=%u sighting_msgs=%u",
+		(unsigned long long)dev_uid64, is_provisioner ? "prov" : "node",
+		k_uptime_get_32(), boot_operational_us(), (int)atomic_get(&provisioned_ms),
+		(int)atomic_get(&configured), (int)atomic_get(&configured_last_ms),
+		peer_table_count(), found,
+		found ? (uint32_t)atomic_get(&discovery_sum_ms) / found : 0,
+		(int)atomic_get(&discovery_max_ms),
+		ring.pushed + ring.dropped, counts[SCAN_CLASS_MFG], reports,
+		mesh.relay.saturated, mesh.relay.high_water, mesh.relay.failed,
+		pub.published, pub.messages);
+
+	k_work_reschedule(&report_work, K_MSEC(CONFIG_BL_BENCH_REPORT_MS));
+}
+
+int bench_start(bool provisioner)
+{
+	if (!IS_ENABLED(CONFIG_BL_BENCH)) {
+		return 0;
+	}
+
+	is_provisioner = provisioner;
+	k_work_reschedule(&report_work, K_MSEC(CONFIG_BL_BENCH_REPORT_MS));
+
+	return 0;
+}
+
+void bench_provisioned(void)
+{
+	if (IS_ENABLED(CONFIG_BL_BENCH)) {
+		atomic_set(&provisioned_ms, k_uptime_get_32());
+	}
+}
+
+void bench_node_configured(uint16_t addr)
+{
+	if (IS_ENABLED(CONFIG_BL_BENCH)) {
+		atomic_inc(&configured);
+		atomic_set(&configured_last_ms, k_uptime_get_32());
+	}
+}
+
+/* All simulated devices boot together, latency is counted from boot */
+void bench_peer_discovered(uint64_t hw_id, uint32_t timestamp_ms)
+{
+	if (!IS_ENABLED(CONFIG_BL_BENCH)) {
+		return;
+	}
+
+	/* Discoveries are rare, a linear search is enough */
+	k_spinlock_key_t key = k_spin_lock(&seen_lock);
+	bool first = seen_count < ARRAY_SIZE(seen);
+
+	for (size_t i = 0; first && i < seen_count; i++) {
+		first = seen[i] != hw_id;
+	}
+	if (first) {
+		seen[seen_count++] = hw_id;
+	}
+
+	k_spin_unlock(&seen_lock, key);
+
+	if (!first) {
+		return;
+	}
+
+	atomic_inc(&discovered);
+	atomic_add(&discovery_sum_ms, timestamp_ms);
+
+	atomic_val_t max = atomic_get(&discovery_max_ms);
+
+	while ((atomic_val_t)timestamp_ms > max &&
+	       !atomic_cas(&discovery_max_ms, max, timestamp_ms)) {
+		max = atomic_get(&discovery_max_ms);
+	}
+}
@@ -0,0 +1,60 @@
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(boot, LOG_LEVEL_DBG);
+
+#include "boot.h"
+
+/* Reached when all of these are */
+#define OPERATIONAL_MASK (BIT(BOOT_BT_READY) | BIT(BOOT_MESH_READY) | BIT(BOOT_FIRST_ADV))
+
+static const char *const milestone_names[BOOT_MILESTONE_COUNT] = {
+	[BOOT_HW_READY] = "hw_ready",
+	[BOOT_BT_READY] = "bt_ready",
+	[BOOT_MESH_READY] = "mesh_ready",
+	[BOOT_FIRST_ADV] = "first_adv",
+	[BOOT_FIRST_PEER] = "first_peer",
+	[BOOT_PROVISIONED] = "provisioned",
+};
+
+static atomic_t milestones[BOOT_MILESTONE_COUNT] = {
+	[0 ... BOOT_MILESTONE_COUNT - 1] = ATOMIC_INIT(-1),
+};
+static atomic_t reached;
+
+void boot_mark(enum boot_milestone milestone)
+{
+	int32_t now = (int32_t)MIN(k_ticks_to_us_floor64(k_uptime_ticks()), INT32_MAX);
+
+	if (!atomic_cas(&milestones[milestone], -1, now)) {
+		return;
+	}
+
+	LOG_INF("BOOT %s us=%d", milestone_names[milestone], now);
+
+	atomic_val_t before = atomic_or(&reached, BIT(milestone));
+
+	/* Only the milestone completing the set reports */
+	if ((before & OPERATIONAL_MASK) != OPERATIONAL_MASK &&
+	    ((before | BIT(milestone)) & OPERATIONAL_MASK) == OPERATIONAL_MASK) {
+		LOG_INF("BOOT operational_us=%d hw_us=%d bt_us=%d mesh_us=%d adv_us=%d", now,
+			boot_milestone_us(BOOT_HW_READY), boot_milestone_us(BOOT_BT_READY),
+			boot_milestone_us(BOOT_MESH_READY), boot_milestone_us(BOOT_FIRST_ADV));
+	}
+}
+
+int32_t boot_milestone_us(enum boot_milestone milestone)
+{
+	return (int32_t)atomic_get(&milestones[milestone]);
+}
+
+int32_t boot_operational_us(void)
+{
+	if ((atomic_get(&reached) & OPERATIONAL_MASK) != OPERATIONAL_MASK) {
+		return -1;
+	}
+
+	return MAX(boot_milestone_us(BOOT_BT_READY),
+		   MAX(boot_milestone_us(BOOT_MESH_READY), boot_milestone_us(BOOT_FIRST_ADV)));
+}
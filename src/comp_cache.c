@@ -0,0 +1,118 @@
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(comp_cache, LOG_LEVEL_DBG);
+
+#include "fake_kconfig.h"
+
+#include "comp_cache.h"
+
+struct comp_cache_entry {
+	struct comp_cache_key key;
+	uint32_t used_ms;
+	/* Zero when the slot is free, every cached product has at least one element */
+	uint8_t elem_count;
+	uint8_t bind_count;
+	struct comp_cache_bind binds[CONFIG_BL_MESH_CFG_MAX_BINDS];
+};
+
+static struct comp_cache_entry cache[CONFIG_BL_MESH_COMP_CACHE_SIZE];
+
+static inline bool entry_used(const struct comp_cache_entry *entry)
+{
+	return entry->elem_count != 0;
+}
+
+static struct comp_cache_entry *entry_find(const struct comp_cache_key *key)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(cache); i++) {
+		if (entry_used(&cache[i]) && !memcmp(&cache[i].key, key, sizeof(*key))) {
+			return &cache[i];
+		}
+	}
+
+	return NULL;
+}
+
+static int entry_copy(struct comp_cache_entry *entry, struct comp_cache_bind *binds, size_t max)
+{
+	if (entry->bind_count > max) {
+		return -ENOMEM;
+	}
+
+	entry->used_ms = k_uptime_get_32();
+	memcpy(binds, entry->binds, entry->bind_count * sizeof(binds[0]));
+
+	return entry->bind_count;
+}
+
+int comp_cache_get(const struct comp_cache_key *key, struct comp_cache_bind *binds, size_t max)
+{
+	struct comp_cache_entry *entry = entry_find(key);
+
+	if (!entry) {
+		return -ENOENT;
+	}
+
+	return entry_copy(entry, binds, max);
+}
+
+int comp_cache_put(const struct comp_cache_key *key, uint8_t elem_count,
+		   const struct comp_cache_bind *binds, size_t count)
+{
+	struct comp_cache_entry *entry = entry_find(key);
+	uint32_t now = k_uptime_get_32();
+
+	if (count > ARRAY_SIZE(entry->binds) || elem_count == 0) {
+		return -EINVAL;
+	}
+
+	/* Replace the least recently used product */
+	if (!entry) {
+		entry = &cache[0];
+		for (size_t i = 0; i < ARRAY_SIZE(cache); i++) {
+			if (!entry_used(&cache[i])) {
+				entry = &cache[i];
+				break;
+			}
+			if (now - cache[i].used_ms > now - entry->used_ms) {
+				entry = &cache[i];
+			}
+		}
+
+		LOG_DBG("Caching product cid 0x%04x pid 0x%04x vid 0x%04x",
+			key->cid, key->pid, key->vid);
+	}
+
+	entry->key = *key;
+	entry->used_ms = now;
+	entry->elem_count = elem_count;
+	entry->bind_count = count;
+	memcpy(entry->binds, binds, count * sizeof(binds[0]));
+
+	return 0;
+}
+
+#define UUID_KEY_OFFSET 8
+
+void comp_cache_key_to_uuid(const struct comp_cache_key *key, uint8_t uuid[16])
+{
+	sys_put_le16(key->cid, &uuid[UUID_KEY_OFFSET]);
+	sys_put_le16(key->pid, &uuid[UUID_KEY_OFFSET + 2]);
+	sys_put_le16(key->vid, &uuid[UUID_KEY_OFFSET + 4]);
+	sys_put_le16(key->crpl, &uuid[UUID_KEY_OFFSET + 6]);
+}
+
+bool comp_cache_key_from_uuid(const uint8_t uuid[16], struct comp_cache_key *key)
+{
+	key->cid = sys_get_le16(&uuid[UUID_KEY_OFFSET]);
+	key->pid = sys_get_le16(&uuid[UUID_KEY_OFFSET + 2]);
+	key->vid = sys_get_le16(&uuid[UUID_KEY_OFFSET + 4]);
+	key->crpl = sys_get_le16(&uuid[UUID_KEY_OFFSET + 6]);
+
+	/* Untagged devices leave these bytes zero */
+	return key->cid != 0;
+}
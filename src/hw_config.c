@@ -10,6 +10,10 @@
 #include <dk_buttons_and_leds.h>
 #endif
 
+#if defined(CONFIG_BOARD_NRF52_BSIM)
+#include "bsim_args_runner.h"
+#endif
+
 #include "hw_config.h"
 
 LOG_MODULE_REGISTER(hw_config, LOG_LEVEL_DBG);
@@ -23,7 +27,15 @@ LOG_MODULE_REGISTER(hw_config, LOG_LEVEL_DBG);
 
 #define PROVISIONER_BUTTON_MSK BIT(PROVISIONER_BUTTON)
 
+/* Handover button, pressed on the provisioner */
+#if IS_ENABLED(CONFIG_DK_LIBRARY)
+#define HANDOVER_BUTTON_MSK BIT(DK_BTN2)
+#else
+#define HANDOVER_BUTTON_MSK 0
+#endif
+
 static bool provisioner_button_state = false;
+static hw_button_cb_t handover_button_cb;
 
 #if IS_ENABLED(CONFIG_DK_LIBRARY)
 static void button_handler(uint32_t button_state, uint32_t has_changed) {
@@ -31,6 +43,10 @@ static void button_handler(uint32_t button_state, uint32_t has_changed) {
 		provisioner_button_state = button_state & PROVISIONER_BUTTON_MSK;
 		LOG_DBG("Provisioner button state is %s", provisioner_button_state ? "pressed" : "released");
 	}
+
+	if ((has_changed & button_state & HANDOVER_BUTTON_MSK) && handover_button_cb) {
+		handover_button_cb();
+	}
 }
 #endif
 
@@ -38,42 +54,44 @@ bool hw_provisioner_button_pressed(void) {
 	return provisioner_button_state;
 }
 
+void hw_handover_button_cb_set(hw_button_cb_t cb) {
+	handover_button_cb = cb;
+}
+
 /* UUID */
 uint8_t dev_uuid[16] = { 0xdd, 0xdd };
 uint64_t dev_uid64 = { 0 };
 
+/* The hardware id is folded into 64 bits, which is the peer identity and
+ * the lower half of the UUID. The upper half carries the product key, see
+ * comp_cache.h. Ids of up to 8 bytes are kept unchanged.
+ */
 static int uuid_from_hw(void) {
 
-	int err = 0;
+#if IS_ENABLED(CONFIG_HWINFO)
+	uint8_t id[16] = { 0 };
+	ssize_t len = hwinfo_get_device_id(id, sizeof(id));
 
-	if(IS_ENABLED(CONFIG_HWINFO)) {
-		err = hwinfo_get_device_id((uint8_t*)(&dev_uid64), sizeof(dev_uid64));
-		if (err < 0) {
-			LOG_ERR("Failed to get device UID64 (err %d)", err);
-			return err;
-		}
-	} else {
-		LOG_WRN("CONFIG_HWINFO is not enabled, using default UID64");
+	if (len < 0) {
+		LOG_ERR("Failed to get device id (err %d)", (int)len);
+		return len;
 	}
 
-    err = 0;
-    if (IS_ENABLED(CONFIG_HWINFO)) {
-		err = hwinfo_get_device_id(dev_uuid, sizeof(dev_uuid));
-		if (err < 0) {
-			LOG_ERR("Failed to get device UUID (err %d)", err);
-			return err;
-		}
-	} else {
-		LOG_WRN("CONFIG_HWINFO is not enabled, using default UUID");
-	}
+	dev_uid64 = 0;
+	for (size_t i = 0; i < (size_t)len; i += sizeof(uint64_t)) {
+		uint64_t chunk;
 
-	if (err < 0) {
-        memset(dev_uuid, 0, sizeof(dev_uuid));
-		dev_uuid[0] = 0xdd;
-		dev_uuid[1] = 0xdd;
+		memcpy(&chunk, &id[i], sizeof(chunk));
+		dev_uid64 ^= chunk;
 	}
 
-    return 0;
+	memset(dev_uuid, 0, sizeof(dev_uuid));
+	memcpy(dev_uuid, &dev_uid64, sizeof(dev_uid64));
+#else
+	LOG_WRN("CONFIG_HWINFO is not enabled, using default UUID");
+#endif
+
+	return 0;
 }
 
 /* Init */
@@ -92,6 +110,9 @@ int hw_init(bool provisioner_button_value_if_not_dk) {
 	dk_read_buttons(&button_state, &has_changed);
 	has_changed = ~0;
 	button_handler(button_state, has_changed);
+	#elif defined(CONFIG_BOARD_NRF52_BSIM)
+	/* Device 0 of the simulation is the provisioner, the others are nodes */
+	provisioner_button_state = bsim_args_get_global_device_nbr() == 0;
 	#else
 	provisioner_button_state = provisioner_button_value_if_not_dk;
 	#endif
@@ -0,0 +1,45 @@
+#include <string.h>
+
+#include <zephyr/kernel.h>
+
+#include "hw_id_index.h"
+
+#define FREE 0
+
+void hw_id_index_clear(const struct hw_id_index *index)
+{
+	memset(index->slots, 0, (index->mask + 1) * sizeof(index->slots[0]));
+}
+
+uint32_t hw_id_index_find(const struct hw_id_index *index, uint64_t hw_id)
+{
+	uint32_t slot = hw_id_hash(hw_id) & index->mask;
+
+	while (index->slots[slot] != FREE &&
+	       index->ids[hw_id_index_get(index, slot)] != hw_id) {
+		slot = (slot + 1) & index->mask;
+	}
+
+	return slot;
+}
+
+void hw_id_index_remove(const struct hw_id_index *index, uint32_t hole)
+{
+	uint32_t next = hole;
+
+	while (true) {
+		next = (next + 1) & index->mask;
+		if (index->slots[next] == FREE) {
+			break;
+		}
+
+		uint32_t home = hw_id_hash(index->ids[hw_id_index_get(index, next)]) & index->mask;
+
+		if (((next - home) & index->mask) >= ((next - hole) & index->mask)) {
+			index->slots[hole] = index->slots[next];
+			hole = next;
+		}
+	}
+
+	index->slots[hole] = FREE;
+}
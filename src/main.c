@@ -12,9 +12,15 @@
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(mesh_scan_coexist, LOG_LEVEL_DBG);
 
-#include "provisioning.h"
-#include "node.h"
+#include "role.h"
+#include "sighting_pub.h"
+#include "prox_graph.h"
+#include "peer_query.h"
+#include "bench.h"
 #include "hw_config.h"
+#include "mesh_stats.h"
+#include "trace.h"
+#include "boot.h"
 
 #include "peer.h"
 
@@ -28,81 +34,119 @@ LOG_MODULE_REGISTER(mesh_scan_coexist, LOG_LEVEL_DBG);
 
 static bool is_provisioner = false;
 
-static int mesh_start(void) {
+static K_SEM_DEFINE(bt_ready_sem, 0, 1);
+static int bt_ready_err;
+
+/* Before settings_load, mesh only restores its state once initialized */
+static int mesh_init(void) {
 	int err = 0;
-	if(is_provisioner) {
-		LOG_INF("Starting as provisioner");
-		err = provisining_init();
-		if (err) {
-			LOG_ERR("Provisioning init failed (err %d)", err);
-			return err;
-		}
 
-		err = bt_mesh_init(&provisioner_prov, &provisioner_mesh_comp);
-		if (err) {
-			LOG_ERR("Initializing mesh failed (err %d)", err);
-			return err;
-		}
-		
-		err = provisioning_start();	
-		if (err) {
-			LOG_ERR("Provisioning start failed (err %d)", err);
-			return err;
-		}
+	err = role_init(is_provisioner);
+	if (err) {
+		LOG_ERR("Role init failed (err %d)", err);
+		return err;
+	}
 
-	} else {
-		LOG_INF("Starting as regular node");
-		err = bt_mesh_init(&node_prov, &node_mesh_comp);
-		if (err) {
-			LOG_ERR("Initializing mesh failed (err %d)", err);
-			return err;
-		}
+	err = bt_mesh_init(&mesh_prov, &mesh_comp);
+	if (err) {
+		LOG_ERR("Initializing mesh failed (err %d)", err);
+		return err;
+	}
 
-		err = node_start();
-		if (err) {
-			LOG_ERR("Node init failed (err %d)", err);
-			return err;
-		}
+	return 0;
+}
+
+static int mesh_start(void) {
+	int err = 0;
+
+	err = role_start();
+	if (err) {
+		LOG_ERR("Role start failed (err %d)", err);
+		return err;
 	}
+
+	boot_mark(BOOT_MESH_READY);
+
+	/* Diagnostics only, the application runs without them */
+	(void)mesh_stats_start();
+
 	return err;
 }
 
 
-static void bt_ready(int err)
+static void handover_button(void)
 {
-	if (err) {
-		LOG_ERR("Bluetooth init failed (err %d)", err);
+	if (!role_is_provisioner()) {
 		return;
 	}
 
-	LOG_INF("Bluetooth initialized");
+	int err = role_handover_nearest();
+	if (err) {
+		LOG_ERR("Handover failed to start (err %d)", err);
+	}
+}
+
+/* Runs on the system work queue, the rest of the start runs on main */
+static void bt_ready(int err)
+{
+	bt_ready_err = err;
+	if (!err) {
+		boot_mark(BOOT_BT_READY);
+	}
+
+	k_sem_give(&bt_ready_sem);
+}
+
+static int app_start(void)
+{
+	int err;
 
 	#if IS_ENABLED(ALTERNATIVE_SEQUENCE) // First peer, then mesh
 		err = peer_start();
 		if (err) {
 			LOG_ERR("Peer start failed (err %d)", err);
-			return;
+			return err;
 		}
 	
 		err = mesh_start();
 		if (err) {
 			LOG_ERR("Mesh start failed (err %d)", err);
-			return;
+			return err;
 		}
 	#else // First mesh, then peer
 		err = mesh_start();
 		if (err) {
 			LOG_ERR("Mesh start failed (err %d)", err);
-			return;
+			return err;
 		}
 	
 		err = peer_start();
 		if (err) {
 			LOG_ERR("Peer start failed (err %d)", err);
-			return;
+			return err;
 		}
 
 	#endif
+
+	err = sighting_pub_start();
+	if (err) {
+		LOG_ERR("Sighting reports failed to start (err %d)", err);
+		return err;
+	}
+
+	err = prox_graph_start();
+	if (err) {
+		LOG_ERR("Proximity graph failed to start (err %d)", err);
+		return err;
+	}
+
+	err = peer_query_poll_start();
+	if (err) {
+		LOG_ERR("Peer query poll failed to start (err %d)", err);
+		return err;
+	}
+
+	return 0;
 }
 
 
@@ -111,25 +155,74 @@ int main(void)
 	int err = 0;
 	LOG_INF("Initializing...");
 
+	/* Diagnostics only, keep going without them */
+	err = trace_start();
+	if (err) {
+		LOG_ERR("Trace start failed (err %d)", err);
+	}
+
 	err = hw_init(CONFIG_FOR_NON_DK__IS_PROVISIONER);
 	if (err) {
 		LOG_ERR("Hardware init failed (err %d)", err);
 		return err;
 	}
+	boot_mark(BOOT_HW_READY);
 	LOG_INF(" - Hardware initialized");
 
 	is_provisioner = hw_provisioner_button_pressed();
 
+	err = bench_start(is_provisioner);
+	if (err) {
+		LOG_ERR("Bench start failed (err %d)", err);
+		return err;
+	}
+
 	/* Initialize the Bluetooth Subsystem */
 	err = bt_enable(bt_ready);
 	if (err) {
 		LOG_ERR("Bluetooth init failed (err %d)", err);
 		return err;
 	}
+
+	/* The host init runs on the system work queue and mostly waits for the
+	 * controller, main is preemptible and prepares what needs no Bluetooth
+	 * meanwhile.
+	 */
+	err = peer_prepare();
+	if (err) {
+		LOG_ERR("Peer prepare failed (err %d)", err);
+		return err;
+	}
+
+	k_sem_take(&bt_ready_sem, K_FOREVER);
+	if (bt_ready_err) {
+		LOG_ERR("Bluetooth init failed (err %d)", bt_ready_err);
+		return bt_ready_err;
+	}
 	LOG_INF(" - Bluetooth initialized");
 
-	while(true) {
-		k_sleep(K_MSEC(500));
+	err = mesh_init();
+	if (err) {
+		return err;
 	}
+
+	/* The only load: the stored role, mesh state, CDB, peer identity and
+	 * peer snapshot are all in place before either start order runs.
+	 */
+	if (IS_ENABLED(CONFIG_SETTINGS)) {
+		err = settings_load();
+		if (err) {
+			LOG_ERR("Failed to load settings (err %d)", err);
+		}
+	}
+
+	err = app_start();
+	if (err) {
+		return err;
+	}
+
+	hw_handover_button_cb_set(handover_button);
+
+	/* Everything else runs on work queues and callbacks */
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,195 @@
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/mesh.h>
+
+/* Mesh internal, from subsys/bluetooth/mesh, see CMakeLists.txt */
+#include "adv.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(mesh_stats, LOG_LEVEL_DBG);
+
+#include "fake_kconfig.h"
+
+#include "mesh_stats.h"
+
+/* Counters at the previous sample, and per report period accumulators for
+ * the queue time
+ */
+struct queue_window {
+	uint32_t planned_last;
+	uint32_t sent_last;
+	uint64_t queued_sum;
+	uint32_t sent_start;
+};
+
+static struct mesh_stats stats = {
+	.relay.pool_size = CONFIG_BT_MESH_RELAY_BUF_COUNT,
+	.local.pool_size = CONFIG_BT_MESH_ADV_BUF_COUNT,
+};
+static struct queue_window relay_window;
+static struct queue_window local_window;
+static uint32_t window_samples;
+static uint32_t window_start_ms;
+static struct k_spinlock stats_lock;
+
+/* Allocation failures, counted from any context the mesh allocates in */
+static atomic_t relay_failed;
+static atomic_t local_failed;
+
+static void sample_work_handle(struct k_work *item);
+static K_WORK_DELAYABLE_DEFINE(sample_work, sample_work_handle);
+
+struct bt_mesh_adv *__real_bt_mesh_adv_create(enum bt_mesh_adv_type type,
+					      enum bt_mesh_adv_tag tag,
+					      uint8_t xmit, k_timeout_t timeout);
+
+/* Mesh returns NULL once the pool of the tag is empty, the relay path drops
+ * the message right away. Every other tag is counted as local.
+ */
+struct bt_mesh_adv *__wrap_bt_mesh_adv_create(enum bt_mesh_adv_type type,
+					      enum bt_mesh_adv_tag tag,
+					      uint8_t xmit, k_timeout_t timeout)
+{
+	struct bt_mesh_adv *adv = __real_bt_mesh_adv_create(type, tag, xmit, timeout);
+
+	if (!adv) {
+		atomic_inc(tag == BT_MESH_ADV_TAG_RELAY ? &relay_failed : &local_failed);
+	}
+
+	return adv;
+}
+
+/* Occupancy is carried from sample to sample by the deltas instead of taken
+ * from the totals, bounded by the pool. An idle sample keeps it: a stalled
+ * advertiser has nothing planned and nothing sent either.
+ */
+static void queue_sample(struct mesh_stats_queue *queue, struct queue_window *window,
+			 uint32_t planned, uint32_t sent, uint32_t failed)
+{
+	uint32_t planned_delta = planned - window->planned_last;
+	uint32_t sent_delta = sent - window->sent_last;
+	int32_t queued = (int32_t)queue->queued + (int32_t)(planned_delta - sent_delta);
+
+	window->planned_last = planned;
+	window->sent_last = sent;
+	queue->planned = planned;
+	queue->sent = sent;
+	queue->failed = failed;
+	queue->queued = CLAMP(queued, 0, queue->pool_size);
+	queue->high_water = MAX(queue->high_water, queue->queued);
+	if (queue->queued >= queue->pool_size) {
+		queue->saturated++;
+	}
+
+	window->queued_sum += queue->queued;
+}
+
+/* W = L / lambda, with L the mean occupancy and lambda the send rate */
+static void queue_window_close(struct mesh_stats_queue *queue, struct queue_window *window,
+			       uint32_t samples, uint32_t period_ms)
+{
+	uint32_t sent = queue->sent - window->sent_start;
+
+	if (sent && samples) {
+		queue->queue_time_ms = (window->queued_sum * period_ms) / ((uint64_t)samples * sent);
+	} else {
+		queue->queue_time_ms = 0;
+	}
+
+	window->queued_sum = 0;
+	window->sent_start = queue->sent;
+}
+
+static void sample_work_handle(struct k_work *item)
+{
+	struct bt_mesh_statistic st;
+	uint32_t now = k_uptime_get_32();
+
+	/* Never scheduled then, but the call must not be linked either */
+	if (!IS_ENABLED(CONFIG_BT_MESH_STATISTIC)) {
+		return;
+	}
+
+	bt_mesh_stat_get(&st);
+
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	queue_sample(&stats.relay, &relay_window,
+		     st.tx_adv_relay_planned, st.tx_adv_relay_succeeded, atomic_get(&relay_failed));
+	queue_sample(&stats.local, &local_window,
+		     st.tx_local_planned, st.tx_local_succeeded, atomic_get(&local_failed));
+	stats.rx_adv = st.rx_adv;
+	stats.rx_proxy = st.rx_proxy;
+	stats.samples++;
+	window_samples++;
+
+	bool report = CONFIG_BL_MESH_STATS_REPORT_MS &&
+		      now - window_start_ms >= CONFIG_BL_MESH_STATS_REPORT_MS;
+
+	if (report) {
+		queue_window_close(&stats.relay, &relay_window, window_samples, now - window_start_ms);
+		queue_window_close(&stats.local, &local_window, window_samples, now - window_start_ms);
+		window_samples = 0;
+		window_start_ms = now;
+	}
+
+	k_spin_unlock(&stats_lock, key);
+
+	if (report) {
+		mesh_stats_report();
+	}
+
+	k_work_reschedule(&sample_work, K_MSEC(CONFIG_BL_MESH_STATS_SAMPLE_MS));
+}
+
+int mesh_stats_start(void)
+{
+	if (!IS_ENABLED(CONFIG_BT_MESH_STATISTIC)) {
+		LOG_WRN("CONFIG_BT_MESH_STATISTIC is not enabled, no mesh statistics");
+		return -ENOTSUP;
+	}
+
+	struct bt_mesh_statistic st;
+
+	/* Whatever mesh sent before we started is not queued */
+	bt_mesh_stat_get(&st);
+	relay_window.planned_last = st.tx_adv_relay_planned;
+	relay_window.sent_last = st.tx_adv_relay_succeeded;
+	relay_window.sent_start = st.tx_adv_relay_succeeded;
+	local_window.planned_last = st.tx_local_planned;
+	local_window.sent_last = st.tx_local_succeeded;
+	local_window.sent_start = st.tx_local_succeeded;
+
+	window_start_ms = k_uptime_get_32();
+	k_work_reschedule(&sample_work, K_NO_WAIT);
+
+	return 0;
+}
+
+void mesh_stats_get(struct mesh_stats *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	*out = stats;
+
+	k_spin_unlock(&stats_lock, key);
+}
+
+static void queue_report(const char *name, const struct mesh_stats_queue *queue)
+{
+	LOG_INF("%s: ~%u/%u queued, high water ~%u, saturated ~%u, failed %u, sent %u/%u, "
+		"~%u ms queued",
+		name, queue->queued, queue->pool_size, queue->high_water, queue->saturated,
+		queue->failed, queue->sent, queue->planned, queue->queue_time_ms);
+}
+
+void mesh_stats_report(void)
+{
+	struct mesh_stats snapshot;
+
+	mesh_stats_get(&snapshot);
+
+	queue_report("Relay", &snapshot.relay);
+	queue_report("Local", &snapshot.local);
+	LOG_INF("Received %u adv, %u proxy (%u samples)",
+		snapshot.rx_adv, snapshot.rx_proxy, snapshot.samples);
+}
@@ -5,6 +5,10 @@
 
 #include "node.h"
 #include "hw_config.h"
+#include "bench.h"
+#include "boot.h"
+#include "comp_cache.h"
+#include "role.h"
 
 /* TODO: Parametrized logging */
 LOG_MODULE_REGISTER(node, LOG_LEVEL_DBG);
@@ -14,6 +18,9 @@ static void prov_complete(uint16_t net_idx, uint16_t addr)
 	LOG_INF("================");
 	LOG_INF("NODE PROVISIONED");
 	LOG_INF("================");
+
+	bench_provisioned();
+	boot_mark(BOOT_PROVISIONED);
 }
 
 static void prov_reset(void)
@@ -21,36 +28,31 @@ static void prov_reset(void)
 	(void)bt_mesh_prov_enable(BT_MESH_PROV_ADV | BT_MESH_PROV_GATT);
 }
 
+/* Forwarded by role.c while this device is a node */
 const struct bt_mesh_prov node_prov = {
-	.uuid = dev_uuid,
 	.complete = prov_complete,
 	.reset = prov_reset,
 };
 
-static const struct bt_mesh_model sig_models[] = {
-	BT_MESH_MODEL_CFG_SRV,
-};
-
-static struct bt_mesh_model vnd_models[] = { };
-
-static const struct bt_mesh_elem elements[] = {
-	BT_MESH_ELEM(0, sig_models, vnd_models),
-};
-
-const struct bt_mesh_comp node_mesh_comp = {
-	.cid = CONFIG_BL_COMPOSITION_COMPANY_ID,
-	.elem = elements,
-	.elem_count = ARRAY_SIZE(elements),
-};
-
 int node_start(void)
 {
 	int err = 0;
-	if (IS_ENABLED(CONFIG_SETTINGS)) {
-		err = settings_load();
-        if (err) {
-            LOG_ERR("Failed to load settings (err %d)", err);
-        }
+
+	/* Lets the provisioner bind our models without fetching composition data */
+	const struct comp_cache_key product = {
+		.cid = mesh_comp.cid,
+		.pid = mesh_comp.pid,
+		.vid = mesh_comp.vid,
+		.crpl = CONFIG_BT_MESH_CRPL,
+	};
+
+	comp_cache_key_to_uuid(&product, dev_uuid);
+
+	/* Stored provisioning data starts the node without provisioning */
+	if (bt_mesh_is_provisioned()) {
+		boot_mark(BOOT_PROVISIONED);
+		LOG_INF("Mesh initialized from stored settings");
+		return 0;
 	}
 
 	err = bt_mesh_prov_enable(BT_MESH_PROV_ADV | BT_MESH_PROV_GATT);
@@ -0,0 +1,642 @@
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/mesh.h>
+#include <zephyr/bluetooth/mesh/access.h>
+#include <zephyr/bluetooth/mesh/cfg_cli.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(node_config, LOG_LEVEL_DBG);
+
+#include "fake_kconfig.h"
+
+#include "node_config.h"
+#include "comp_cache.h"
+#include "mesh_vnd.h"
+
+#define CID_SIG 0xFFFF
+
+enum cfg_op {
+	CFG_OP_APP_KEY_ADD,
+	CFG_OP_COMP_GET,
+	CFG_OP_BIND,
+	CFG_OP_SUB_ADD,
+};
+
+enum cfg_job_flag {
+	CFG_JOB_KEY_SENT  = BIT(0),
+	CFG_JOB_KEY_DONE  = BIT(1),
+	CFG_JOB_COMP_SENT = BIT(2),
+	CFG_JOB_COMP_DONE = BIT(3),
+	/* Bind list taken from the cache without fetching composition data */
+	CFG_JOB_CACHED    = BIT(4),
+	/* Sightings group subscription, only wanted on the provisioner itself */
+	CFG_JOB_SUB_SENT  = BIT(5),
+	CFG_JOB_SUB_DONE  = BIT(6),
+};
+
+struct cfg_bind {
+	uint16_t elem_addr;
+	uint16_t id;
+	uint16_t cid;
+};
+
+struct cfg_job {
+	/* BT_MESH_ADDR_UNASSIGNED when the slot is free */
+	uint16_t addr;
+	uint8_t flags;
+	uint8_t bind_count;
+	uint8_t bind_next;
+	uint8_t bind_done;
+	int err;
+	struct cfg_bind binds[CONFIG_BL_MESH_CFG_MAX_BINDS];
+};
+
+struct cfg_req {
+	struct cfg_job *job;
+	uint32_t deadline_ms;
+	uint8_t op;
+	uint8_t bind_idx;
+	uint8_t retries;
+};
+
+struct cfg_result {
+	uint16_t addr;
+	int err;
+};
+
+/* Snapshot of a request taken under the lock, sent after releasing it */
+struct cfg_send {
+	uint16_t addr;
+	uint8_t op;
+	struct cfg_bind bind;
+};
+
+static struct cfg_job jobs[CONFIG_BL_MESH_CFG_MAX_JOBS];
+static struct cfg_req reqs[CONFIG_BL_MESH_CFG_MAX_INFLIGHT];
+static size_t job_rr;
+/* Only taken from threads: the configuration queue, the mesh RX thread for
+ * the client callbacks and the provisioning state machine. A mutex, the
+ * composition data is parsed with it held.
+ */
+static K_MUTEX_DEFINE(cfg_lock);
+
+static struct k_work_q *cfg_queue;
+static node_config_done_t cfg_done;
+static uint16_t cfg_net_idx;
+static uint16_t cfg_app_idx;
+
+static void node_config_work_cb(struct k_work *item);
+static K_WORK_DELAYABLE_DEFINE(cfg_work, node_config_work_cb);
+
+static void node_config_kick(void)
+{
+	k_work_reschedule_for_queue(cfg_queue, &cfg_work, K_NO_WAIT);
+}
+
+static struct cfg_req *req_find(uint16_t addr, uint8_t op, uint16_t elem_addr, uint16_t id)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(reqs); i++) {
+		struct cfg_req *req = &reqs[i];
+
+		if (!req->job || req->job->addr != addr || req->op != op) {
+			continue;
+		}
+
+		if (op == CFG_OP_BIND) {
+			const struct cfg_bind *bind = &req->job->binds[req->bind_idx];
+
+			if (bind->elem_addr != elem_addr || bind->id != id) {
+				continue;
+			}
+		}
+
+		return req;
+	}
+
+	return NULL;
+}
+
+static bool job_complete(const struct cfg_job *job)
+{
+	return (job->flags & CFG_JOB_KEY_DONE) &&
+	       (job->flags & CFG_JOB_COMP_DONE) &&
+	       (job->flags & CFG_JOB_SUB_DONE) &&
+	       job->bind_done == job->bind_count;
+}
+
+/* Next request of a job that can be sent now, false if it has to wait */
+static bool job_next_op(struct cfg_job *job, struct cfg_req *req)
+{
+	if (!(job->flags & CFG_JOB_KEY_SENT)) {
+		job->flags |= CFG_JOB_KEY_SENT;
+		req->op = CFG_OP_APP_KEY_ADD;
+		return true;
+	}
+
+	/* Composition data is fetched while the app key is in flight */
+	if (!(job->flags & CFG_JOB_COMP_SENT)) {
+		job->flags |= CFG_JOB_COMP_SENT;
+		req->op = CFG_OP_COMP_GET;
+		return true;
+	}
+
+	/* Binding needs the key on the node and the model list */
+	if ((job->flags & CFG_JOB_KEY_DONE) && (job->flags & CFG_JOB_COMP_DONE) &&
+	    job->bind_next < job->bind_count) {
+		req->op = CFG_OP_BIND;
+		req->bind_idx = job->bind_next++;
+		return true;
+	}
+
+	/* Subscribing needs the model bound, the node drops what it cannot decrypt */
+	if (!(job->flags & CFG_JOB_SUB_SENT) && (job->flags & CFG_JOB_COMP_DONE) &&
+	    job->bind_done == job->bind_count) {
+		job->flags |= CFG_JOB_SUB_SENT;
+		req->op = CFG_OP_SUB_ADD;
+		return true;
+	}
+
+	return false;
+}
+
+static void req_snapshot(const struct cfg_req *req, struct cfg_send *send)
+{
+	send->addr = req->job->addr;
+	send->op = req->op;
+	if (req->op == CFG_OP_BIND) {
+		send->bind = req->job->binds[req->bind_idx];
+	}
+}
+
+static void req_free_job(const struct cfg_job *job)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(reqs); i++) {
+		if (reqs[i].job == job) {
+			reqs[i].job = NULL;
+		}
+	}
+}
+
+static int req_send(const struct cfg_send *send)
+{
+	struct bt_mesh_cdb_app_key *key;
+	uint8_t app_key[16];
+	int err;
+
+	/* Passing no status pointer makes the client return without waiting,
+	 * the response arrives through node_config_cli_cb.
+	 */
+	switch (send->op) {
+	case CFG_OP_APP_KEY_ADD:
+		key = bt_mesh_cdb_app_key_get(cfg_app_idx);
+		if (key == NULL) {
+			LOG_ERR("No app-key 0x%04x", cfg_app_idx);
+			return -ENOENT;
+		}
+
+		err = bt_mesh_cdb_app_key_export(key, 0, app_key);
+		if (err) {
+			LOG_ERR("Failed to export appkey from cdb. Err:%d", err);
+			return err;
+		}
+
+		LOG_DBG("Configuring node 0x%04x...", send->addr);
+		return bt_mesh_cfg_cli_app_key_add(cfg_net_idx, send->addr, cfg_net_idx,
+						   cfg_app_idx, app_key, NULL);
+	case CFG_OP_COMP_GET:
+		return bt_mesh_cfg_cli_comp_data_get(cfg_net_idx, send->addr, 0, NULL, NULL);
+	case CFG_OP_BIND:
+		if (send->bind.cid == CID_SIG) {
+			LOG_DBG("Binding AppKey to model 0x%03x:%04x",
+				send->bind.elem_addr, send->bind.id);
+			return bt_mesh_cfg_cli_mod_app_bind(cfg_net_idx, send->addr,
+							    send->bind.elem_addr, cfg_app_idx,
+							    send->bind.id, NULL);
+		}
+
+		LOG_DBG("Binding AppKey to model 0x%03x:%04x:%04x",
+			send->bind.elem_addr, send->bind.cid, send->bind.id);
+		return bt_mesh_cfg_cli_mod_app_bind_vnd(cfg_net_idx, send->addr,
+							send->bind.elem_addr, cfg_app_idx,
+							send->bind.id, send->bind.cid, NULL);
+	case CFG_OP_SUB_ADD:
+		LOG_DBG("Subscribing 0x%04x to the sightings group", send->addr);
+		return bt_mesh_cfg_cli_mod_sub_add_vnd(cfg_net_idx, send->addr, send->addr,
+						       CONFIG_BL_SIGHTINGS_GROUP,
+						       VND_MODEL_ID_SIGHTINGS,
+						       CONFIG_BL_COMPOSITION_COMPANY_ID, NULL);
+	default:
+		return -EINVAL;
+	}
+}
+
+static void node_config_work_cb(struct k_work *item)
+{
+	struct cfg_send sends[CONFIG_BL_MESH_CFG_MAX_INFLIGHT];
+	struct cfg_result finished[CONFIG_BL_MESH_CFG_MAX_JOBS];
+	size_t send_count = 0;
+	size_t finished_count = 0;
+	uint32_t now = k_uptime_get_32();
+	int32_t next_deadline = INT32_MAX;
+
+	k_mutex_lock(&cfg_lock, K_FOREVER);
+
+	/* Timeouts, resent in place or failing the whole job */
+	for (size_t i = 0; i < ARRAY_SIZE(reqs); i++) {
+		struct cfg_req *req = &reqs[i];
+
+		if (!req->job || (int32_t)(now - req->deadline_ms) < 0) {
+			continue;
+		}
+
+		if (req->retries < CONFIG_BL_MESH_CFG_RETRIES) {
+			req->retries++;
+			req->deadline_ms = now + CONFIG_BL_MESH_CFG_TIMEOUT_MS;
+			req_snapshot(req, &sends[send_count++]);
+		} else {
+			req->job->err = -ETIMEDOUT;
+		}
+	}
+
+	/* Finished jobs release their slot and all of their requests */
+	for (size_t i = 0; i < ARRAY_SIZE(jobs); i++) {
+		struct cfg_job *job = &jobs[i];
+
+		if (job->addr == BT_MESH_ADDR_UNASSIGNED) {
+			continue;
+		}
+
+		if (job->err || job_complete(job)) {
+			finished[finished_count++] = (struct cfg_result) {
+				.addr = job->addr, .err = job->err,
+			};
+			req_free_job(job);
+			job->addr = BT_MESH_ADDR_UNASSIGNED;
+		}
+	}
+
+	/* Fill free request slots round robin, one request per node per pass */
+	for (size_t i = 0; i < ARRAY_SIZE(reqs); i++) {
+		struct cfg_req *req = &reqs[i];
+		bool found = false;
+
+		if (req->job) {
+			continue;
+		}
+
+		for (size_t n = 0; n < ARRAY_SIZE(jobs) && !found; n++) {
+			struct cfg_job *job = &jobs[job_rr];
+
+			job_rr = (job_rr + 1) % ARRAY_SIZE(jobs);
+			if (job->addr == BT_MESH_ADDR_UNASSIGNED) {
+				continue;
+			}
+
+			found = job_next_op(job, req);
+			if (found) {
+				req->job = job;
+				req->retries = 0;
+				req->deadline_ms = now + CONFIG_BL_MESH_CFG_TIMEOUT_MS;
+				req_snapshot(req, &sends[send_count++]);
+			}
+		}
+
+		if (!found) {
+			break;
+		}
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(reqs); i++) {
+		if (reqs[i].job) {
+			next_deadline = MIN(next_deadline, (int32_t)(reqs[i].deadline_ms - now));
+		}
+	}
+
+	k_mutex_unlock(&cfg_lock);
+
+	/* A failed send is left in flight and retried when it times out */
+	for (size_t i = 0; i < send_count; i++) {
+		int err = req_send(&sends[i]);
+
+		if (err) {
+			LOG_WRN("Config request to 0x%04x failed (err %d)", sends[i].addr, err);
+		}
+	}
+
+	for (size_t i = 0; i < finished_count; i++) {
+		if (finished[i].err) {
+			LOG_ERR("Configuring node 0x%04x failed (err %d)",
+				finished[i].addr, finished[i].err);
+		} else {
+			LOG_DBG("Configuration of 0x%04x complete", finished[i].addr);
+		}
+
+		cfg_done(finished[i].addr, finished[i].err);
+	}
+
+	if (next_deadline != INT32_MAX) {
+		k_work_reschedule_for_queue(cfg_queue, &cfg_work, K_MSEC(MAX(next_deadline, 1)));
+	}
+}
+
+static void app_key_status(struct bt_mesh_cfg_cli *cli, uint16_t addr, uint8_t status,
+			   uint16_t net_idx, uint16_t app_idx)
+{
+	k_mutex_lock(&cfg_lock, K_FOREVER);
+
+	struct cfg_req *req = req_find(addr, CFG_OP_APP_KEY_ADD, 0, 0);
+
+	if (req) {
+		/* Already stored answers a retry of a request the node took */
+		if (status == BT_MESH_STATUS_SUCCESS ||
+		    status == BT_MESH_STATUS_IDX_ALREADY_STORED) {
+			req->job->flags |= CFG_JOB_KEY_DONE;
+		} else {
+			LOG_ERR("Failed to add app-key (status %d)", status);
+			req->job->err = -EIO;
+		}
+		req->job = NULL;
+	}
+
+	k_mutex_unlock(&cfg_lock);
+
+	if (req) {
+		node_config_kick();
+	}
+}
+
+static void job_binds_from_cache(struct cfg_job *job, const struct comp_cache_bind *binds,
+				 size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		job->binds[i] = (struct cfg_bind) {
+			.elem_addr = job->addr + binds[i].elem_offset,
+			.id = binds[i].id,
+			.cid = binds[i].cid,
+		};
+	}
+
+	job->bind_count = count;
+}
+
+static void job_binds_to_cache(const struct cfg_job *job, struct comp_cache_bind *binds)
+{
+	for (size_t i = 0; i < job->bind_count; i++) {
+		binds[i] = (struct comp_cache_bind) {
+			.elem_offset = job->binds[i].elem_addr - job->addr,
+			.id = job->binds[i].id,
+			.cid = job->binds[i].cid,
+		};
+	}
+}
+
+/* Fills the bind list of a job from Composition Data Page 0, the element
+ * walk is skipped for products already in the cache.
+ */
+static int comp_parse(struct cfg_job *job, struct net_buf_simple *buf)
+{
+	struct comp_cache_bind cached[CONFIG_BL_MESH_CFG_MAX_BINDS];
+	struct bt_mesh_comp_p0_elem elem;
+	struct bt_mesh_comp_p0 comp;
+	struct comp_cache_key key;
+	uint16_t elem_addr = job->addr;
+	int err;
+
+	err = bt_mesh_comp_p0_get(&comp, buf);
+	if (err) {
+		LOG_ERR("Unable to parse composition data (err: %d)", err);
+		return err;
+	}
+
+	key = (struct comp_cache_key) {
+		.cid = comp.cid, .pid = comp.pid, .vid = comp.vid, .crpl = comp.crpl,
+	};
+
+	err = comp_cache_get(&key, cached, ARRAY_SIZE(cached));
+	if (err >= 0) {
+		job_binds_from_cache(job, cached, err);
+		return 0;
+	}
+
+	job->bind_count = 0;
+	while (bt_mesh_comp_p0_elem_pull(&comp, &elem)) {
+		LOG_DBG("Element @ 0x%04x: %u + %u models", elem_addr,
+			elem.nsig, elem.nvnd);
+
+		for (int i = 0; i < elem.nsig; i++) {
+			uint16_t id = bt_mesh_comp_p0_elem_mod(&elem, i);
+
+			if (id == BT_MESH_MODEL_ID_CFG_CLI ||
+			    id == BT_MESH_MODEL_ID_CFG_SRV) {
+				continue;
+			}
+
+			if (job->bind_count == ARRAY_SIZE(job->binds)) {
+				return -ENOMEM;
+			}
+
+			job->binds[job->bind_count++] = (struct cfg_bind) {
+				.elem_addr = elem_addr, .id = id, .cid = CID_SIG,
+			};
+		}
+
+		for (int i = 0; i < elem.nvnd; i++) {
+			struct bt_mesh_mod_id_vnd id = bt_mesh_comp_p0_elem_mod_vnd(&elem, i);
+
+			/* Device key only, its key slot is taken */
+			if (id.company == CONFIG_BL_COMPOSITION_COMPANY_ID &&
+			    id.id == VND_MODEL_ID_HANDOVER) {
+				continue;
+			}
+
+			if (job->bind_count == ARRAY_SIZE(job->binds)) {
+				return -ENOMEM;
+			}
+
+			job->binds[job->bind_count++] = (struct cfg_bind) {
+				.elem_addr = elem_addr, .id = id.id, .cid = id.company,
+			};
+		}
+
+		elem_addr++;
+	}
+
+	job_binds_to_cache(job, cached);
+	comp_cache_put(&key, elem_addr - job->addr, cached, job->bind_count);
+
+	return 0;
+}
+
+static void comp_data(struct bt_mesh_cfg_cli *cli, uint16_t addr, uint8_t page,
+		      struct net_buf_simple *buf)
+{
+	k_mutex_lock(&cfg_lock, K_FOREVER);
+
+	struct cfg_req *req = req_find(addr, CFG_OP_COMP_GET, 0, 0);
+
+	if (req) {
+		int err = comp_parse(req->job, buf);
+
+		if (err) {
+			req->job->err = err;
+		} else {
+			req->job->flags |= CFG_JOB_COMP_DONE;
+		}
+		req->job = NULL;
+	}
+
+	k_mutex_unlock(&cfg_lock);
+
+	if (req) {
+		node_config_kick();
+	}
+}
+
+static void mod_app_status(struct bt_mesh_cfg_cli *cli, uint16_t addr, uint8_t status,
+			   uint16_t elem_addr, uint16_t app_idx, uint32_t mod_id)
+{
+	k_mutex_lock(&cfg_lock, K_FOREVER);
+
+	struct cfg_req *req = req_find(addr, CFG_OP_BIND, elem_addr, mod_id & 0xFFFF);
+
+	if (req && (req->job->flags & CFG_JOB_CACHED) &&
+	    (status == BT_MESH_STATUS_INVALID_MODEL || status == BT_MESH_STATUS_INVALID_ADDRESS)) {
+		/* The node is not the product its UUID claims, fetch its composition data */
+		struct cfg_job *job = req->job;
+
+		LOG_DBG("Cached layout does not match 0x%04x", job->addr);
+		req_free_job(job);
+		job->flags &= ~(CFG_JOB_CACHED | CFG_JOB_COMP_SENT | CFG_JOB_COMP_DONE);
+		job->bind_count = 0;
+		job->bind_next = 0;
+		job->bind_done = 0;
+	} else if (req) {
+		/* A model that cannot be bound does not fail the whole node */
+		if (status != BT_MESH_STATUS_SUCCESS) {
+			LOG_ERR("Failed to bind model %d (status: %d)", mod_id & 0xFFFF, status);
+		}
+		req->job->bind_done++;
+		req->job = NULL;
+	}
+
+	k_mutex_unlock(&cfg_lock);
+
+	if (req) {
+		node_config_kick();
+	}
+}
+
+static void mod_sub_status(struct bt_mesh_cfg_cli *cli, uint16_t addr, uint8_t status,
+			   uint16_t elem_addr, uint16_t sub_addr, uint32_t mod_id)
+{
+	k_mutex_lock(&cfg_lock, K_FOREVER);
+
+	struct cfg_req *req = req_find(addr, CFG_OP_SUB_ADD, 0, 0);
+
+	if (req) {
+		if (status == BT_MESH_STATUS_SUCCESS) {
+			req->job->flags |= CFG_JOB_SUB_DONE;
+		} else {
+			LOG_ERR("Failed to subscribe to the sightings group (status %d)", status);
+			req->job->err = -EIO;
+		}
+		req->job = NULL;
+	}
+
+	k_mutex_unlock(&cfg_lock);
+
+	if (req) {
+		node_config_kick();
+	}
+}
+
+const struct bt_mesh_cfg_cli_cb node_config_cli_cb = {
+	.comp_data = comp_data,
+	.app_key_status = app_key_status,
+	.mod_app_status = mod_app_status,
+	.mod_sub_status = mod_sub_status,
+};
+
+int node_config_init(struct k_work_q *queue, uint16_t net_idx, uint16_t app_idx,
+		     node_config_done_t done)
+{
+	if (!queue || !done) {
+		return -EINVAL;
+	}
+
+	cfg_queue = queue;
+	cfg_done = done;
+	cfg_net_idx = net_idx;
+	cfg_app_idx = app_idx;
+
+	return 0;
+}
+
+int node_config_add(uint16_t addr, const struct comp_cache_key *product)
+{
+	struct comp_cache_bind cached[CONFIG_BL_MESH_CFG_MAX_BINDS];
+	struct cfg_job *free_job = NULL;
+	int err = 0;
+
+	k_mutex_lock(&cfg_lock, K_FOREVER);
+
+	for (size_t i = 0; i < ARRAY_SIZE(jobs); i++) {
+		if (jobs[i].addr == addr) {
+			err = -EALREADY;
+			break;
+		}
+		if (!free_job && jobs[i].addr == BT_MESH_ADDR_UNASSIGNED) {
+			free_job = &jobs[i];
+		}
+	}
+
+	if (!err && !free_job) {
+		err = -ENOMEM;
+	}
+
+	if (!err) {
+		*free_job = (struct cfg_job) { .addr = addr };
+
+		/* Sightings are for the provisioner only */
+		if (addr != bt_mesh_primary_addr()) {
+			free_job->flags |= CFG_JOB_SUB_SENT | CFG_JOB_SUB_DONE;
+		}
+
+		/* Skip the segmented composition data fetch for a known product */
+		int count = product ? comp_cache_get(product, cached, ARRAY_SIZE(cached)) : -ENOENT;
+
+		if (count >= 0) {
+			job_binds_from_cache(free_job, cached, count);
+			free_job->flags |= CFG_JOB_CACHED | CFG_JOB_COMP_SENT | CFG_JOB_COMP_DONE;
+		}
+	}
+
+	k_mutex_unlock(&cfg_lock);
+
+	if (!err) {
+		node_config_kick();
+	}
+
+	return err;
+}
+
+int node_config_sightings_leave(void)
+{
+	uint16_t addr = bt_mesh_primary_addr();
+
+	return bt_mesh_cfg_cli_mod_sub_del_vnd(cfg_net_idx, addr, addr, CONFIG_BL_SIGHTINGS_GROUP,
+					       VND_MODEL_ID_SIGHTINGS,
+					       CONFIG_BL_COMPOSITION_COMPANY_ID, NULL);
+}
+
+size_t node_config_pending(void)
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(jobs); i++) {
+		if (jobs[i].addr != BT_MESH_ADDR_UNASSIGNED) {
+			count++;
+		}
+	}
+
+	return count;
+}
@@ -4,124 +4,168 @@
  * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
  */
 
+#include <string.h>
+
 #include <zephyr/kernel.h>
 #include <zephyr/bluetooth/bluetooth.h>
 #include <zephyr/sys/byteorder.h>
-#include <bluetooth/scan.h>
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(peer, LOG_LEVEL_DBG);
 
+#include "adv_budget.h"
+#include "adv_ctrl.h"
+#include "bench.h"
 #include "hw_config.h"
 #include "peer.h"
+#include "peer_table.h"
+#include "peer_store.h"
+#include "boot.h"
+#include "scan_dispatch.h"
+#include "scan_sched.h"
+#include "sighting_ring.h"
+#include "trace.h"
+#include "fake_kconfig.h"
 
 #define DEVICE_NAME             CONFIG_BT_DEVICE_NAME
 #define DEVICE_NAME_LEN         (sizeof(DEVICE_NAME) - 1)
-
-#define SUPPORT_PEER_CODE         0xAABBDDFF
-
-struct adv_mfg_data {
-	uint16_t company_code;
-	uint32_t support_peer_code;
-	uint64_t hw_id;
-} __packed;
+/* The default identity is left to mesh */
+#define PEER_ID                 1
 
 static struct adv_mfg_data mfg_data = { 0 };
 struct bt_le_adv_param adv_param_conn =
 	BT_LE_ADV_PARAM_INIT(BT_LE_ADV_OPT_CONNECTABLE |
 			     BT_LE_ADV_OPT_NOTIFY_SCAN_REQ,
-			     BT_GAP_ADV_FAST_INT_MIN_2,
-			     BT_GAP_ADV_FAST_INT_MAX_2,
+			     CONFIG_BL_SCAN_SCHED_DISCOVERY_INT_MIN,
+			     CONFIG_BL_SCAN_SCHED_DISCOVERY_INT_MAX,
 			     NULL);
 
 struct bt_le_adv_param adv_param_noconn =
 	BT_LE_ADV_PARAM_INIT(BT_LE_ADV_OPT_USE_IDENTITY |
 			     BT_LE_ADV_OPT_SCANNABLE |
 			     BT_LE_ADV_OPT_NOTIFY_SCAN_REQ,
-			     BT_GAP_ADV_FAST_INT_MIN_2,
-			     BT_GAP_ADV_FAST_INT_MAX_2,
+			     CONFIG_BL_SCAN_SCHED_DISCOVERY_INT_MIN,
+			     CONFIG_BL_SCAN_SCHED_DISCOVERY_INT_MAX,
 			     NULL);
 
 
 struct bt_le_adv_param *adv_param = &adv_param_conn;
 
+/* Manufacturer data goes in the advertising data so that the passive mesh
+ * scanner sees it, without scan requests.
+ */
 static const struct bt_data ad[] = {
 	BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
-	BT_DATA(BT_DATA_NAME_COMPLETE, DEVICE_NAME, DEVICE_NAME_LEN),
-};
-
-static const struct bt_data sd[] = {
 	BT_DATA(BT_DATA_MANUFACTURER_DATA, (unsigned char *)&mfg_data, sizeof(mfg_data)),
 };
 
-static struct bt_le_scan_param scan_param = {
-	.type     = BT_LE_SCAN_TYPE_ACTIVE,
-	.interval = BT_GAP_SCAN_FAST_INTERVAL,
-	.window   = BT_GAP_SCAN_FAST_WINDOW,
-	.options  = BT_LE_SCAN_OPT_NONE,
-	.timeout  = 0,
+static const struct bt_data sd[] = {
+	BT_DATA(BT_DATA_NAME_COMPLETE, DEVICE_NAME, DEVICE_NAME_LEN),
 };
 
-static struct bt_scan_init_param scan_init = {
-	.connect_if_match = 0,
-	.scan_param = &scan_param,
-	.conn_param = NULL
-};
+static void adv_work_handle(struct k_work *item);
+static K_WORK_DEFINE(adv_work, adv_work_handle);
 
-static struct bt_scan_manufacturer_data scan_mfg_data = {
-	.data = (unsigned char *)&mfg_data,
-	.data_len = (
-		  sizeof(mfg_data.company_code)
-		+ sizeof(mfg_data.support_peer_code)
-	),
+/* Sightings are processed off the Bluetooth RX thread, which mesh also
+ * uses for relaying.
+ */
+K_THREAD_STACK_DEFINE(peer_stack_area, CONFIG_BL_PEER_QUEUE_STACK_SIZE);
+static struct k_work_q peer_queue = { 0 };
+static const struct k_work_queue_config peer_queue_cfg = {
+	.name = "peer_queue",
+	.no_yield = false,
 };
 
-static struct bt_le_ext_adv *adv;
-static void adv_work_handle(struct k_work *item);
-static K_WORK_DEFINE(adv_work, adv_work_handle);
+static void sighting_work_handle(struct k_work *item);
+static K_WORK_DEFINE(sighting_work, sighting_work_handle);
+static uint32_t sighting_dropped_reported;
 
-static bool data_cb(struct bt_data *data, void *user_data)
+static void peer_sighting(const struct peer_sighting *sighting)
 {
-	struct adv_mfg_data *recv_mfg_data;
-	
-	switch (data->type) {
-	/* Simply print the filtered device */
-	case BT_DATA_MANUFACTURER_DATA:
-		if (sizeof(struct adv_mfg_data) == data->data_len) {
-			bt_addr_le_t* addr = user_data;
-			recv_mfg_data = (struct adv_mfg_data *)data->data;
-			
-			char addr_str[BT_ADDR_LE_STR_LEN] = { 0 };
-			bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
-			uint64_t hw_id = sys_le64_to_cpu(recv_mfg_data->hw_id);
-			LOG_WRN(
-				"SCANNED AND FILTERED peer of addr %s and hw_id %" PRIu64,
-				addr_str,
-				hw_id
-			);
+	int err = peer_table_update(&sighting->addr, sighting->hw_id, sighting->rssi);
+	if (err < 0) {
+		LOG_DBG("Peer table full, dropping hw_id %" PRIu64, sighting->hw_id);
+	} else if (err == 1) {
+		scan_sched_kick();
+		bench_peer_discovered(sighting->hw_id, sighting->timestamp_ms);
+		boot_mark(BOOT_FIRST_PEER);
+
+		/* Only new peers are logged */
+		if (TRACE_ENABLED(PEER)) {
+			TRACE(PEER, TRACE_EVT_PEER_NEW, (uint16_t)sighting->rssi,
+			      (uint32_t)sighting->hw_id, (uint32_t)(sighting->hw_id >> 32));
+			return;
 		}
-		return false;
-	default:
-		return true;
+
+		char addr_str[BT_ADDR_LE_STR_LEN] = { 0 };
+		bt_addr_le_to_str(&sighting->addr, addr_str, sizeof(addr_str));
+		LOG_WRN(
+			"SCANNED AND FILTERED peer of addr %s and hw_id %" PRIu64,
+			addr_str,
+			sighting->hw_id
+		);
+	}
+}
+
+static void sighting_work_handle(struct k_work *item)
+{
+	struct peer_sighting batch[CONFIG_BL_SIGHTING_BATCH];
+	struct sighting_ring_stats stats;
+	size_t count;
+
+	count = sighting_ring_pop_batch(batch, ARRAY_SIZE(batch));
+	for (size_t i = 0; i < count; i++) {
+		peer_sighting(&batch[i]);
+	}
+
+	sighting_ring_stats_get(&stats);
+	if (stats.dropped != sighting_dropped_reported) {
+		LOG_WRN("Sighting ring overflow, %u dropped (high water %u)",
+			stats.dropped - sighting_dropped_reported, stats.high_water);
+		sighting_dropped_reported = stats.dropped;
+	}
+
+	/* Let other work run between batches */
+	if (!sighting_ring_empty()) {
+		k_work_submit_to_queue(&peer_queue, item);
 	}
 }
 
-static void scan_filter_match(struct bt_scan_device_info *device_info,
-			      struct bt_scan_filter_match *filter_match,
-			      bool connectable)
+/* Runs on the Bluetooth RX thread: match, push and get out */
+static void scan_recv(enum scan_class cls, const struct scan_report *report)
 {
-	bt_addr_le_t addr;
-	bt_addr_le_copy(&addr, device_info->recv_info->addr);
-	bt_data_parse(device_info->adv_data, data_cb, &addr);
+	struct peer_sighting sighting;
+
+	if (!peer_mfg_match(report->data, report->data_len, &sighting.hw_id)) {
+		return;
+	}
+
+	sighting.timestamp_ms = k_uptime_get_32();
+	sighting.rssi = report->info->rssi;
+	bt_addr_le_copy(&sighting.addr, report->info->addr);
+
+	if (sighting_ring_push(&sighting)) {
+		k_work_submit_to_queue(&peer_queue, &sighting_work);
+	}
 }
 
-BT_SCAN_CB_INIT(scan_cb, scan_filter_match, NULL, NULL, NULL);
+static struct scan_consumer scan_consumer = {
+	.class_mask = BIT(SCAN_CLASS_MFG),
+	.recv = scan_recv,
+};
 
 static void adv_scanned_cb(struct bt_le_ext_adv *adv,
 			struct bt_le_ext_adv_scanned_info *info)
 {
 	ARG_UNUSED(adv);
-	ARG_UNUSED(info);
+
+	if (TRACE_ENABLED(ADV)) {
+		const uint8_t *val = info->addr->a.val;
+
+		TRACE(ADV, TRACE_EVT_ADV_SCANNED, info->addr->type,
+		      sys_get_le32(&val[0]), sys_get_le16(&val[4]));
+		return;
+	}
 
 	LOG_DBG("SCANNING is working (I've been scanned)");
 }
@@ -130,50 +174,23 @@ const static struct bt_le_ext_adv_cb adv_cb = {
 	.scanned = adv_scanned_cb,
 };
 
-static int adv_start(void)
+static void adv_work_handle(struct k_work *item)
 {
-	int err;
-	struct bt_le_ext_adv_start_param ext_adv_start_param = {0};
-
-	
-
-	if (adv) {
-		err = bt_le_ext_adv_stop(adv);
-		if (err) {
-			LOG_ERR("Failed to stop extended advertising  (err %d)", err);
-			return err;
-		}
-			err = bt_le_ext_adv_delete(adv);
-		if (err) {
-			LOG_ERR("Failed to delete advertising set  (err %d)", err);
-			return err;
-		}
-	}
-
-	err = bt_le_ext_adv_create(adv_param, &adv_cb, &adv);
-	if (err) {
-		LOG_ERR("Failed to create advertising set (err %d)", err);
-		return err;
-	}
-
-	err = bt_le_ext_adv_set_data(adv, ad, ARRAY_SIZE(ad), sd, ARRAY_SIZE(sd));
+	int err = adv_ctrl_param_set(adv_param);
 	if (err) {
-		LOG_ERR("Failed setting adv data (err %d)", err);
-		return err;
+		LOG_ERR("Failed to switch advertising parameters (err %d)", err);
 	}
-
-	err = bt_le_ext_adv_start(adv, &ext_adv_start_param);
-	if (err) {
-		LOG_ERR("Failed to start extended advertising  (err %d)", err);
-		return err;
-	}
-
-	return err;
 }
 
-static void adv_work_handle(struct k_work *item)
+int peer_adv_interval_set(uint16_t min, uint16_t max)
 {
-	adv_start();
+	adv_param_conn.interval_min = min;
+	adv_param_conn.interval_max = max;
+	adv_param_noconn.interval_min = min;
+	adv_param_noconn.interval_max = max;
+
+	/* Same queue as the connection switches, so they never overlap */
+	return adv_ctrl_param_set(adv_param);
 }
 
 static void connected(struct bt_conn *conn, uint8_t conn_err)
@@ -200,25 +217,21 @@ static int scan_start(void)
 {
 	int err;
 
-	bt_scan_init(&scan_init);
-	bt_scan_cb_register(&scan_cb);
-
-	err = bt_scan_filter_add(BT_SCAN_FILTER_TYPE_MANUFACTURER_DATA, &scan_mfg_data);
+	err = scan_dispatch_register(&scan_consumer);
 	if (err) {
-		LOG_ERR("Scanning filters cannot be set (err %d)", err);
+		LOG_ERR("Scan consumer cannot be registered (err %d)", err);
 		return err;
 	}
 
-	err = bt_scan_filter_enable(BT_SCAN_MANUFACTURER_DATA_FILTER, false);
+	err = scan_dispatch_start();
 	if (err) {
-		LOG_ERR("Filters cannot be turned on (err %d)", err);
+		LOG_ERR("Scanning failed to start (err %d)", err);
 		return err;
 	}
 
-	err = bt_scan_start(BT_SCAN_TYPE_SCAN_ACTIVE);
-	if(err == -EALREADY) { err = 0; } // Mesh may already started to scan
+	err = scan_sched_start();
 	if (err) {
-		LOG_ERR("Scanning failed to start (err %d)", err);
+		LOG_ERR("Scan scheduler failed to start (err %d)", err);
 		return err;
 	}
 
@@ -234,15 +247,20 @@ static int prepare_identity(void)
 	 */
 	(void)bt_id_get(NULL, &id_count);
 
-	if (id_count != 1) {
-		LOG_ERR("Expected only default identity so far, there currently are %d", id_count);
-		return -EINVAL;
-	}
+	int id = PEER_ID;
 
-	int id = bt_id_create(NULL, NULL);
-	if (id < 0) {
-		LOG_ERR("Failed to create identity (err %d)", id);
-		return id;
+	/* Restored from settings by an earlier boot */
+	if (id_count > PEER_ID) {
+		LOG_DBG("Using stored identity %d", id);
+	} else if (id_count == PEER_ID) {
+		id = bt_id_create(NULL, NULL);
+		if (id < 0) {
+			LOG_ERR("Failed to create identity (err %d)", id);
+			return id;
+		}
+	} else {
+		LOG_ERR("Expected the default identity, there currently are %zu", id_count);
+		return -EINVAL;
 	}
 
 	adv_param_conn.id = id;
@@ -251,25 +269,60 @@ static int prepare_identity(void)
 	return 0;
 }
 
-int peer_start() {
-	
+int peer_prepare(void)
+{
 	int err = 0;
 
 	mfg_data.company_code = sys_cpu_to_le16(CONFIG_BT_COMPANY_ID_NORDIC);
 	mfg_data.support_peer_code = sys_cpu_to_le32(SUPPORT_PEER_CODE);
 	mfg_data.hw_id = dev_uid64; // From hw_config.h
 
+	err = peer_table_init();
+	if (err) {
+		LOG_ERR("Failed to init peer table (err %d)", err);
+		return err;
+	}
+
+	err = peer_store_start();
+	if (err) {
+		LOG_ERR("Failed to start peer store (err %d)", err);
+		return err;
+	}
+
+	return err;
+}
+
+int peer_start() {
+	
+	int err = 0;
+
+	k_work_queue_init(&peer_queue);
+	k_work_queue_start(
+		&peer_queue,
+		peer_stack_area,
+		K_THREAD_STACK_SIZEOF(peer_stack_area),
+		CONFIG_BL_PEER_QUEUE_PRIORITY,
+		&peer_queue_cfg
+	);
+
 	err = prepare_identity();
 	if (err) {
 		LOG_ERR("Failed to prepare identity (err %d)", err);
 		return err;
 	}
 	
-	err = adv_start();
+	err = adv_budget_start();
+	if (err) {
+		LOG_ERR("Failed to start advertising set budget (err %d)", err);
+		return err;
+	}
+
+	err = adv_ctrl_start(adv_param, &adv_cb, ad, ARRAY_SIZE(ad), sd, ARRAY_SIZE(sd));
 	if (err) {
 		LOG_ERR("Failed to start advertising (err %d)", err);
 		return err;
 	}
+	boot_mark(BOOT_FIRST_ADV);
 
 	err = scan_start();
 	if (err) {
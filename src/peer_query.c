@@ -0,0 +1,829 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/random/random.h>
+#include <zephyr/bluetooth/mesh.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(peer_query, LOG_LEVEL_DBG);
+
+#include "fake_kconfig.h"
+
+#include "peer_query.h"
+#include "mesh_vnd.h"
+#include "peer_table.h"
+#include "role.h"
+
+/* Access payload of an unsegmented message, opcode included */
+#define UNSEG_SDU_MAX   11
+
+/* Record kinds, in the low bits of the record tag */
+#define KIND_ADDED      0
+#define KIND_CHANGED    1
+#define KIND_REMOVED    2
+#define KIND_BITS       2
+#define KIND_MASK       BIT_MASK(KIND_BITS)
+
+/* Status flags */
+#define FLAG_RESET      BIT(0)
+#define FLAG_FULL       BIT(1)
+#define FLAG_MORE       BIT(2)
+
+/* Epoch, generation and flags, all at their largest */
+#define STATUS_HDR_MAX  (4 + 5 + 1)
+/* Tag, hw_id and RSSI */
+#define RECORD_MAX      (5 + 8 + 1)
+
+BUILD_ASSERT(VND_PAYLOAD_MAX >= STATUS_HDR_MAX + RECORD_MAX,
+	     "A status message must fit a record");
+BUILD_ASSERT(CONFIG_BL_PEER_CAPACITY <= UINT8_MAX, "Peers are queried by 8 bit ids");
+
+static peer_query_cb_t change_cb;
+
+static struct peer_query_stats stats;
+static struct k_spinlock stats_lock;
+
+/* LEB128, 7 bits per byte, least significant first */
+static size_t varint_len(uint32_t val)
+{
+	size_t len = 1;
+
+	while (val >= 0x80) {
+		val >>= 7;
+		len++;
+	}
+
+	return len;
+}
+
+static void varint_add(struct net_buf_simple *buf, uint32_t val)
+{
+	while (val >= 0x80) {
+		net_buf_simple_add_u8(buf, (val & 0x7f) | 0x80);
+		val >>= 7;
+	}
+
+	net_buf_simple_add_u8(buf, val);
+}
+
+static int varint_pull(struct net_buf_simple *buf, uint32_t *val)
+{
+	uint32_t out = 0;
+
+	for (int shift = 0; shift < 32; shift += 7) {
+		if (!buf->len) {
+			return -EMSGSIZE;
+		}
+
+		uint8_t byte = net_buf_simple_pull_u8(buf);
+
+		out |= (uint32_t)(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) {
+			*val = out;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+/* Server
+ *
+ * The view is the peer set as last reported, refreshed from the peer table
+ * when a query comes in. A peer keeps its view slot, and so its id, for as
+ * long as it stays in the table. Every change takes the next generation, so
+ * a response can stop after any record and still leave the client at a
+ * consistent generation. Only touched from the mesh RX thread.
+ */
+struct view_entry {
+	uint64_t hw_id;
+	uint32_t added_gen;
+	uint32_t changed_gen;
+	int8_t rssi;
+	bool used;
+	bool seen;
+};
+
+struct tombstone {
+	uint32_t gen;
+	uint32_t added_gen;
+	uint8_t id;
+};
+
+/* A record to send, in generation order */
+struct delta_rec {
+	uint32_t gen;
+	uint8_t id;
+	uint8_t kind;
+};
+
+static struct view_entry view[CONFIG_BL_PEER_CAPACITY];
+
+/* Ring of the most recent removals */
+static struct tombstone tombstones[CONFIG_BL_PEER_QUERY_TOMBSTONES];
+static size_t tomb_head;
+static size_t tomb_count;
+
+/* Boot nonce, generations of another boot number other id spaces */
+static uint32_t epoch;
+static uint32_t gen;
+/* Newest removal no longer remembered, clients behind it need a reset */
+static uint32_t floor_gen;
+
+static struct delta_rec delta[CONFIG_BL_PEER_CAPACITY + CONFIG_BL_PEER_QUERY_TOMBSTONES];
+NET_BUF_SIMPLE_DEFINE_STATIC(records, VND_PAYLOAD_MAX);
+
+static void tombstone_add(uint8_t id, uint32_t added_gen)
+{
+	if (tomb_count == ARRAY_SIZE(tombstones)) {
+		size_t tail = (tomb_head + ARRAY_SIZE(tombstones) - tomb_count) %
+			      ARRAY_SIZE(tombstones);
+
+		floor_gen = tombstones[tail].gen;
+		tomb_count--;
+	}
+
+	tombstones[tomb_head] = (struct tombstone) {
+		.gen = ++gen, .added_gen = added_gen, .id = id,
+	};
+	tomb_head = (tomb_head + 1) % ARRAY_SIZE(tombstones);
+	tomb_count++;
+}
+
+static struct view_entry *view_find(uint64_t hw_id)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(view); i++) {
+		if (view[i].used && view[i].hw_id == hw_id) {
+			return &view[i];
+		}
+	}
+
+	return NULL;
+}
+
+/* Marks the peers still in the table and takes their RSSI changes */
+static bool view_update(const struct peer_entry *entry, void *user_data)
+{
+	int8_t rssi = PEER_RSSI_Q8_TO_DBM(entry->rssi_q8);
+	struct view_entry *e = view_find(entry->hw_id);
+
+	if (!e) {
+		return true;
+	}
+
+	e->seen = true;
+	if (abs(rssi - e->rssi) >= CONFIG_BL_PEER_QUERY_RSSI_DELTA) {
+		e->rssi = rssi;
+		e->changed_gen = ++gen;
+	}
+
+	return true;
+}
+
+static bool view_add(const struct peer_entry *entry, void *user_data)
+{
+	int8_t rssi = PEER_RSSI_Q8_TO_DBM(entry->rssi_q8);
+
+	if (view_find(entry->hw_id)) {
+		return true;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(view); i++) {
+		if (!view[i].used) {
+			gen++;
+			view[i] = (struct view_entry) {
+				.hw_id = entry->hw_id,
+				.added_gen = gen,
+				.changed_gen = gen,
+				.rssi = rssi,
+				.used = true,
+				.seen = true,
+			};
+			return true;
+		}
+	}
+
+	/* Only when the table filled up during the walks */
+	return false;
+}
+
+static void view_refresh(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(view); i++) {
+		view[i].seen = false;
+	}
+
+	peer_table_foreach(view_update, NULL);
+
+	/* Free the slots of peers gone from the table before adding new ones */
+	for (size_t i = 0; i < ARRAY_SIZE(view); i++) {
+		if (view[i].used && !view[i].seen) {
+			view[i].used = false;
+			tombstone_add(i, view[i].added_gen);
+		}
+	}
+
+	peer_table_foreach(view_add, NULL);
+}
+
+static size_t record_add(uint8_t id, uint8_t kind, size_t room)
+{
+	uint32_t tag = (id << KIND_BITS) | kind;
+	size_t len = varint_len(tag);
+
+	if (kind == KIND_ADDED) {
+		len += 8 + 1;
+	} else if (kind == KIND_CHANGED) {
+		len += 1;
+	}
+
+	if (records.len + len > room) {
+		return 0;
+	}
+
+	varint_add(&records, tag);
+	if (kind == KIND_ADDED) {
+		net_buf_simple_add_le64(&records, view[id].hw_id);
+	}
+	if (kind != KIND_REMOVED) {
+		net_buf_simple_add_u8(&records, (uint8_t)view[id].rssi);
+	}
+
+	return len;
+}
+
+/* Insertion sort, the list is short and mostly in order already */
+static void delta_insert(size_t count, uint32_t rec_gen, uint8_t id, uint8_t kind)
+{
+	size_t i = count;
+
+	while (i > 0 && delta[i - 1].gen > rec_gen) {
+		delta[i] = delta[i - 1];
+		i--;
+	}
+
+	delta[i] = (struct delta_rec) { .gen = rec_gen, .id = id, .kind = kind };
+}
+
+/* Changes after since. A peer added after since is sorted at the generation
+ * it was added at: its record carries the current RSSI too, and a page that
+ * ends between the add and a later change must leave the peer known to the
+ * client, so that the next page sends it as changed.
+ */
+static size_t delta_collect(uint32_t since)
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(view); i++) {
+		if (!view[i].used || view[i].changed_gen <= since) {
+			continue;
+		}
+
+		if (view[i].added_gen > since) {
+			delta_insert(count++, view[i].added_gen, i, KIND_ADDED);
+		} else {
+			delta_insert(count++, view[i].changed_gen, i, KIND_CHANGED);
+		}
+	}
+
+	for (size_t i = 0; i < tomb_count; i++) {
+		const struct tombstone *t = &tombstones[(tomb_head + ARRAY_SIZE(tombstones) - 1 - i) %
+							ARRAY_SIZE(tombstones)];
+
+		if (t->gen <= since) {
+			break;
+		}
+		/* Added and removed again, the client never knew the peer */
+		if (t->added_gen > since) {
+			continue;
+		}
+
+		delta_insert(count++, t->gen, t->id, KIND_REMOVED);
+	}
+
+	return count;
+}
+
+/* Encodes as many records as fit, returns the generation reached */
+static uint32_t delta_encode(size_t count, size_t room, bool *more)
+{
+	net_buf_simple_reset(&records);
+	*more = false;
+
+	for (size_t i = 0; i < count; i++) {
+		/* The first record always fits */
+		if (!record_add(delta[i].id, delta[i].kind, room)) {
+			*more = true;
+			return delta[i - 1].gen;
+		}
+	}
+
+	return gen;
+}
+
+/* Encodes the live peers from id cursor on as added, in id order. Paging
+ * by generation does not work here, a peer added long ago may have changed
+ * after the page it would have been in. Peers added after the transfer
+ * started at since are left to the deltas that follow it, which only skip
+ * the removal of peers the client cannot know.
+ */
+static void full_encode(uint32_t since, uint8_t cursor, size_t room, bool *more)
+{
+	net_buf_simple_reset(&records);
+	*more = false;
+
+	for (size_t i = cursor; i < ARRAY_SIZE(view); i++) {
+		if (!view[i].used || view[i].added_gen > since) {
+			continue;
+		}
+
+		if (!record_add(i, KIND_ADDED, room)) {
+			*more = true;
+			return;
+		}
+	}
+}
+
+static int query_get(const struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx,
+		     struct net_buf_simple *buf)
+{
+	BT_MESH_MODEL_BUF_DEFINE(msg, VND_OP_PEER_QUERY_STATUS, VND_PAYLOAD_MAX);
+	size_t room;
+	uint32_t since_epoch;
+	uint32_t since;
+	uint32_t reached;
+	uint8_t cursor = 0;
+	uint8_t flags = 0;
+	bool more;
+	int err;
+
+	since_epoch = net_buf_simple_pull_le32(buf);
+	err = varint_pull(buf, &since);
+	if (err || buf->len > 1) {
+		return -EINVAL;
+	}
+
+	/* A cursor continues a full transfer based on since */
+	if (buf->len) {
+		cursor = net_buf_simple_pull_u8(buf);
+		flags |= FLAG_FULL;
+	}
+
+	view_refresh();
+
+	/* Generations of another boot, or behind the oldest remembered
+	 * removal, start over with the full table. Changes made while it is
+	 * transferred come with the following deltas.
+	 */
+	if (since_epoch != epoch || since < floor_gen || since > gen) {
+		flags |= FLAG_RESET | FLAG_FULL;
+		since = gen;
+		cursor = 0;
+	}
+
+	/* Less the header, the generation reached is at most gen */
+	room = VND_PAYLOAD_MAX - 4 - varint_len(gen) - 1;
+
+	if (flags & FLAG_FULL) {
+		full_encode(since, cursor, room, &more);
+		reached = since;
+	} else {
+		reached = delta_encode(delta_collect(since), room, &more);
+	}
+
+	if (more) {
+		flags |= FLAG_MORE;
+	}
+
+	bt_mesh_model_msg_init(&msg, VND_OP_PEER_QUERY_STATUS);
+	net_buf_simple_add_le32(&msg, epoch);
+	varint_add(&msg, reached);
+	net_buf_simple_add_u8(&msg, flags);
+	net_buf_simple_add_mem(&msg, records.data, records.len);
+
+	err = bt_mesh_model_send(model, ctx, &msg, NULL, NULL);
+	if (err) {
+		LOG_ERR("Failed to send peer query status (err %d)", err);
+		return err;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	stats.responses++;
+	/* Opcode included */
+	stats.unsegmented += msg.len <= UNSEG_SDU_MAX;
+	stats.full += !!(flags & FLAG_RESET);
+
+	k_spin_unlock(&stats_lock, key);
+
+	return 0;
+}
+
+const struct bt_mesh_model_op peer_query_srv_ops[] = {
+	{ VND_OP_PEER_QUERY_GET, BT_MESH_LEN_MIN(4 + 1), query_get },
+	BT_MESH_MODEL_OP_END,
+};
+
+static int query_srv_init(const struct bt_mesh_model *model)
+{
+	/* Never 0, which clients without a mirror send */
+	do {
+		epoch = sys_rand32_get();
+	} while (!epoch);
+
+	return 0;
+}
+
+const struct bt_mesh_model_cb peer_query_srv_cb = {
+	.init = query_srv_init,
+};
+
+/* Client
+ *
+ * Mirrors of the id to hw_id mapping of the most recently queried nodes.
+ * The least recently used mirror is dropped for a new node.
+ */
+struct mirror {
+	uint16_t addr;
+	uint32_t epoch;
+	uint32_t gen;
+	uint32_t used_ms;
+	/* Full transfer in progress, continues from cursor */
+	bool full;
+	uint8_t cursor;
+	uint64_t hw_ids[CONFIG_BL_PEER_CAPACITY];
+	bool present[CONFIG_BL_PEER_CAPACITY];
+};
+
+static const struct bt_mesh_model *cli_model;
+static struct mirror mirrors[CONFIG_BL_PEER_QUERY_MIRRORS];
+static K_MUTEX_DEFINE(cli_lock);
+
+static void mirror_clear(struct mirror *m)
+{
+	m->epoch = 0;
+	m->gen = 0;
+	m->full = false;
+	memset(m->present, 0, sizeof(m->present));
+}
+
+static struct mirror *mirror_find(uint16_t addr)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(mirrors); i++) {
+		if (mirrors[i].addr == addr) {
+			return &mirrors[i];
+		}
+	}
+
+	return NULL;
+}
+
+static struct mirror *mirror_get(uint16_t addr, uint32_t now)
+{
+	struct mirror *m = mirror_find(addr);
+
+	if (!m) {
+		m = &mirrors[0];
+		for (size_t i = 0; i < ARRAY_SIZE(mirrors); i++) {
+			if (mirrors[i].addr == BT_MESH_ADDR_UNASSIGNED) {
+				m = &mirrors[i];
+				break;
+			}
+			if (now - mirrors[i].used_ms > now - m->used_ms) {
+				m = &mirrors[i];
+			}
+		}
+
+		if (m->addr != BT_MESH_ADDR_UNASSIGNED) {
+			LOG_DBG("Dropping peer mirror of 0x%04x", m->addr);
+		}
+
+		m->addr = addr;
+		mirror_clear(m);
+	}
+
+	m->used_ms = now;
+
+	return m;
+}
+
+static void change_emit(uint16_t addr, enum peer_query_kind kind, uint64_t hw_id, int8_t rssi)
+{
+	struct peer_query_change change = {
+		.kind = kind, .hw_id = hw_id, .rssi = rssi,
+	};
+
+	if (change_cb) {
+		change_cb(addr, &change);
+	}
+}
+
+static int query_send(struct mirror *m)
+{
+	BT_MESH_MODEL_BUF_DEFINE(msg, VND_OP_PEER_QUERY_GET, 4 + 5 + 1);
+	struct bt_mesh_msg_ctx ctx = BT_MESH_MSG_CTX_INIT_APP(CONFIG_BL_PEER_QUERY_APP_IDX,
+							      m->addr);
+	int err;
+
+	bt_mesh_model_msg_init(&msg, VND_OP_PEER_QUERY_GET);
+	net_buf_simple_add_le32(&msg, m->epoch);
+	varint_add(&msg, m->gen);
+	if (m->full) {
+		net_buf_simple_add_u8(&msg, m->cursor);
+	}
+
+	err = bt_mesh_model_send(cli_model, &ctx, &msg, NULL, NULL);
+	if (err) {
+		return err;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	stats.requests++;
+
+	k_spin_unlock(&stats_lock, key);
+
+	return 0;
+}
+
+static int record_apply(uint16_t addr, struct mirror *m, struct net_buf_simple *buf,
+			uint8_t *id_out)
+{
+	uint32_t tag;
+	uint8_t id;
+	int err;
+
+	err = varint_pull(buf, &tag);
+	if (err) {
+		return err;
+	}
+
+	if ((tag >> KIND_BITS) >= CONFIG_BL_PEER_CAPACITY) {
+		return -EINVAL;
+	}
+
+	id = tag >> KIND_BITS;
+	*id_out = id;
+
+	switch (tag & KIND_MASK) {
+	case KIND_ADDED:
+		if (buf->len < 8 + 1) {
+			return -EMSGSIZE;
+		}
+
+		m->hw_ids[id] = net_buf_simple_pull_le64(buf);
+		m->present[id] = true;
+		change_emit(addr, PEER_QUERY_ADDED, m->hw_ids[id],
+			    (int8_t)net_buf_simple_pull_u8(buf));
+		return 0;
+	case KIND_CHANGED:
+		if (buf->len < 1) {
+			return -EMSGSIZE;
+		}
+		if (!m->present[id]) {
+			return -ENOENT;
+		}
+
+		change_emit(addr, PEER_QUERY_CHANGED, m->hw_ids[id],
+			    (int8_t)net_buf_simple_pull_u8(buf));
+		return 0;
+	case KIND_REMOVED:
+		/* Gone before a full transfer reached it */
+		if (!m->present[id]) {
+			return 0;
+		}
+
+		m->present[id] = false;
+		change_emit(addr, PEER_QUERY_REMOVED, m->hw_ids[id], 0);
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+static int query_status(const struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx,
+			struct net_buf_simple *buf)
+{
+	uint16_t len = buf->len;
+	uint32_t srv_epoch;
+	uint32_t reached;
+	uint32_t changes = 0;
+	uint8_t last_id = 0;
+	uint8_t flags;
+	int err;
+
+	srv_epoch = net_buf_simple_pull_le32(buf);
+	err = varint_pull(buf, &reached);
+	if (err || !buf->len) {
+		return -EINVAL;
+	}
+
+	flags = net_buf_simple_pull_u8(buf);
+
+	k_mutex_lock(&cli_lock, K_FOREVER);
+
+	struct mirror *m = mirror_get(ctx->addr, k_uptime_get_32());
+
+	if (flags & FLAG_RESET) {
+		mirror_clear(m);
+		m->epoch = srv_epoch;
+		change_emit(ctx->addr, PEER_QUERY_RESET, 0, 0);
+	}
+
+	/* Records of another boot of the node, or a late status of one */
+	err = srv_epoch == m->epoch ? 0 : -ESTALE;
+
+	while (!err && buf->len) {
+		err = record_apply(ctx->addr, m, buf, &last_id);
+		if (!err) {
+			changes++;
+		}
+	}
+
+	if (err) {
+		/* Out of step, the next query starts over */
+		LOG_WRN("Bad peer query status from 0x%04x (err %d)", ctx->addr, err);
+		mirror_clear(m);
+		change_emit(ctx->addr, PEER_QUERY_RESET, 0, 0);
+	} else {
+		m->gen = reached;
+		m->full = (flags & FLAG_FULL) && (flags & FLAG_MORE);
+		m->cursor = last_id + 1;
+		/* A finished full transfer is followed by the changes made
+		 * while it ran.
+		 */
+		if (flags & (FLAG_MORE | FLAG_FULL)) {
+			err = query_send(m);
+			if (err) {
+				LOG_ERR("Failed to follow up peer query (err %d)", err);
+			}
+		} else {
+			change_emit(ctx->addr, PEER_QUERY_SYNCED, 0, 0);
+		}
+	}
+
+	k_mutex_unlock(&cli_lock);
+
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	stats.changes += changes;
+	stats.status_bytes += len;
+
+	k_spin_unlock(&stats_lock, key);
+
+	return 0;
+}
+
+const struct bt_mesh_model_op peer_query_cli_ops[] = {
+	{ VND_OP_PEER_QUERY_STATUS, BT_MESH_LEN_MIN(4 + 2), query_status },
+	BT_MESH_MODEL_OP_END,
+};
+
+static int query_cli_init(const struct bt_mesh_model *model)
+{
+	cli_model = model;
+
+	return 0;
+}
+
+const struct bt_mesh_model_cb peer_query_cli_cb = {
+	.init = query_cli_init,
+};
+
+int peer_query_get(uint16_t addr)
+{
+	int err;
+
+	if (!IS_ENABLED(CONFIG_BL_PROVISIONER)) {
+		return -ENOTSUP;
+	}
+	if (!cli_model) {
+		return -ENODEV;
+	}
+	if (!BT_MESH_ADDR_IS_UNICAST(addr)) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&cli_lock, K_FOREVER);
+
+	err = query_send(mirror_get(addr, k_uptime_get_32()));
+
+	k_mutex_unlock(&cli_lock);
+
+	return err;
+}
+
+/* Poll
+ *
+ * Only nodes that hold a mirror, or can take a free one, are polled. A poll
+ * that evicted a mirror would get that node's full table on every round.
+ */
+struct poll_next {
+	uint16_t after;
+	uint16_t first;
+	uint16_t next;
+	bool mirror_free;
+};
+
+static void poll_work_handle(struct k_work *item);
+static K_WORK_DELAYABLE_DEFINE(poll_work, poll_work_handle);
+static uint16_t poll_last;
+
+/* Lowest configured address after the last one polled, and the lowest of
+ * all to wrap around
+ */
+static uint8_t poll_node_check(struct bt_mesh_cdb_node *node, void *user_data)
+{
+	struct poll_next *poll = user_data;
+
+	if (!atomic_test_bit(node->flags, BT_MESH_CDB_NODE_CONFIGURED) ||
+	    node->addr == bt_mesh_primary_addr()) {
+		return BT_MESH_CDB_ITER_CONTINUE;
+	}
+
+	if (!poll->mirror_free && !mirror_find(node->addr)) {
+		return BT_MESH_CDB_ITER_CONTINUE;
+	}
+
+	poll->first = MIN(poll->first, node->addr);
+	if (node->addr > poll->after) {
+		poll->next = MIN(poll->next, node->addr);
+	}
+
+	return BT_MESH_CDB_ITER_CONTINUE;
+}
+
+static void poll_work_handle(struct k_work *item)
+{
+	struct poll_next poll = {
+		.after = poll_last, .first = UINT16_MAX, .next = UINT16_MAX,
+	};
+
+	if (role_is_provisioner()) {
+		k_mutex_lock(&cli_lock, K_FOREVER);
+
+		poll.mirror_free = mirror_find(BT_MESH_ADDR_UNASSIGNED) != NULL;
+		bt_mesh_cdb_node_foreach(poll_node_check, &poll);
+
+		k_mutex_unlock(&cli_lock);
+
+		if (poll.next == UINT16_MAX) {
+			poll.next = poll.first;
+		}
+	}
+
+	if (poll.next != UINT16_MAX) {
+		poll_last = poll.next;
+
+		int err = peer_query_get(poll.next);
+		if (err) {
+			LOG_WRN("Peer query of 0x%04x failed (err %d)", poll.next, err);
+		}
+	}
+
+	k_work_reschedule(&poll_work, K_MSEC(CONFIG_BL_PEER_QUERY_POLL_MS));
+}
+
+int peer_query_poll_start(void)
+{
+	if (!IS_ENABLED(CONFIG_BL_PROVISIONER)) {
+		return 0;
+	}
+	if (!cli_model) {
+		return -ENODEV;
+	}
+
+	k_work_reschedule(&poll_work, K_MSEC(CONFIG_BL_PEER_QUERY_POLL_MS));
+
+	return 0;
+}
+
+void peer_query_forget(uint16_t addr)
+{
+	k_mutex_lock(&cli_lock, K_FOREVER);
+
+	struct mirror *m = mirror_find(addr);
+
+	if (m) {
+		mirror_clear(m);
+		m->addr = BT_MESH_ADDR_UNASSIGNED;
+	}
+
+	k_mutex_unlock(&cli_lock);
+}
+
+void peer_query_cb_set(peer_query_cb_t cb)
+{
+	change_cb = cb;
+}
+
+void peer_query_stats_get(struct peer_query_stats *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	*out = stats;
+
+	k_spin_unlock(&stats_lock, key);
+}
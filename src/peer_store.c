@@ -0,0 +1,167 @@
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(peer_store, LOG_LEVEL_DBG);
+
+#include "fake_kconfig.h"
+
+#include "hw_id_index.h"
+#include "peer_store.h"
+#include "peer_table.h"
+
+BUILD_ASSERT(CONFIG_BL_PEER_STORE_MAX <= CONFIG_BL_PEER_NEAREST_MAX,
+	     "The snapshot is taken from the nearest peers");
+
+#define STORE_KEY "bl/peers/snap"
+
+struct peer_store_record {
+	uint64_t hw_id;
+	bt_addr_le_t addr;
+	int8_t rssi;
+} __packed;
+
+static struct peer_store_record restored[CONFIG_BL_PEER_STORE_MAX];
+static size_t restored_count;
+static bool settings_loaded;
+static bool started;
+
+/* Identifies the stored set of peers, so unchanged snapshots are not written */
+static uint32_t stored_digest;
+static uint32_t store_count;
+
+static void store_work_handle(struct k_work *item);
+static K_WORK_DELAYABLE_DEFINE(store_work, store_work_handle);
+
+static void restore(void)
+{
+	size_t added = 0;
+
+	for (size_t i = 0; i < restored_count; i++) {
+		if (peer_table_update(&restored[i].addr, restored[i].hw_id, restored[i].rssi) == 1) {
+			added++;
+		}
+	}
+
+	if (restored_count) {
+		LOG_INF("Restored %zu of %zu stored peers", added, restored_count);
+	}
+	restored_count = 0;
+}
+
+/* Order independent, the nearest peers come sorted by a changing RSSI */
+static uint32_t digest(const struct peer_store_record *records, size_t count)
+{
+	uint32_t sum = count;
+
+	for (size_t i = 0; i < count; i++) {
+		sum += hw_id_hash(records[i].hw_id);
+	}
+
+	return sum;
+}
+
+int peer_store_flush(void)
+{
+	struct peer_entry nearest[CONFIG_BL_PEER_STORE_MAX];
+	struct peer_store_record records[CONFIG_BL_PEER_STORE_MAX];
+	size_t count;
+	uint32_t sum;
+	int err;
+
+	if (!IS_ENABLED(CONFIG_SETTINGS)) {
+		return -ENOTSUP;
+	}
+
+	count = peer_table_nearest(nearest, ARRAY_SIZE(nearest));
+	for (size_t i = 0; i < count; i++) {
+		records[i].hw_id = nearest[i].hw_id;
+		bt_addr_le_copy(&records[i].addr, &nearest[i].bt_addr);
+		records[i].rssi = PEER_RSSI_Q8_TO_DBM(nearest[i].rssi_q8);
+	}
+
+	/* An empty table is not stored, the last snapshot is a better guess */
+	sum = digest(records, count);
+	if (count == 0 || sum == stored_digest) {
+		return 0;
+	}
+
+	err = settings_save_one(STORE_KEY, records, count * sizeof(records[0]));
+	if (err) {
+		LOG_ERR("Failed to store peers (err %d)", err);
+		return err;
+	}
+
+	stored_digest = sum;
+	store_count++;
+	LOG_DBG("Stored %zu peers (write %u)", count, store_count);
+
+	return 0;
+}
+
+static void store_work_handle(struct k_work *item)
+{
+	(void)peer_store_flush();
+
+	k_work_schedule(&store_work, K_MSEC(CONFIG_BL_PEER_STORE_INTERVAL_MS));
+}
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+static int peer_store_set(const char *key, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+	ssize_t read;
+
+	if (strcmp(key, "snap")) {
+		return -ENOENT;
+	}
+
+	/* A snapshot from a build with a larger limit keeps its nearest peers */
+	len = MIN(len, sizeof(restored));
+	if (len % sizeof(restored[0])) {
+		return -EINVAL;
+	}
+
+	read = read_cb(cb_arg, restored, len);
+	if (read < 0) {
+		return read;
+	}
+
+	restored_count = read / sizeof(restored[0]);
+	/* Storing the same peers again is not needed */
+	stored_digest = digest(restored, restored_count);
+
+	return 0;
+}
+
+static int peer_store_commit(void)
+{
+	/* Settings are loaded and peer_start runs on the same thread */
+	settings_loaded = true;
+	if (started) {
+		restore();
+	}
+
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(bl_peers, "bl/peers", NULL, peer_store_set, peer_store_commit,
+			       NULL);
+#endif
+
+int peer_store_start(void)
+{
+	if (!IS_ENABLED(CONFIG_SETTINGS)) {
+		return 0;
+	}
+
+	started = true;
+	if (settings_loaded) {
+		restore();
+	}
+
+	k_work_schedule(&store_work, K_MSEC(CONFIG_BL_PEER_STORE_INTERVAL_MS));
+
+	return 0;
+}
@@ -0,0 +1,299 @@
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(peer_table, LOG_LEVEL_DBG);
+
+#include "fake_kconfig.h"
+
+#include "hw_id_index.h"
+#include "peer_table.h"
+
+BUILD_ASSERT(IS_POWER_OF_TWO(CONFIG_BL_PEER_TABLE_SIZE), "Peer table size must be a power of two");
+/* Keep some slots free so that probe sequences stay short */
+BUILD_ASSERT(CONFIG_BL_PEER_CAPACITY <= CONFIG_BL_PEER_TABLE_SIZE * 3 / 4,
+	     "Peer capacity must stay below 3/4 of the table size");
+BUILD_ASSERT(CONFIG_BL_PEER_CAPACITY < UINT16_MAX, "Peers are indexed with 16 bits");
+
+/* Exponential moving average with alpha = 1 / 2^RSSI_EMA_SHIFT */
+#define RSSI_EMA_SHIFT  CONFIG_BL_PEER_RSSI_EMA_SHIFT
+
+/* Hash index of 16 bit peer indices, see hw_id_index.h. The peers themselves
+ * are stored densely, one array per field, so aging and nearest scans only
+ * walk the fields they need and never skip over free slots. The address is
+ * only read when an entry is copied out.
+ */
+static uint16_t table[CONFIG_BL_PEER_TABLE_SIZE];
+
+static uint64_t peer_ids[CONFIG_BL_PEER_CAPACITY];
+static uint32_t peer_seen_ms[CONFIG_BL_PEER_CAPACITY];
+static int16_t peer_rssi_q8[CONFIG_BL_PEER_CAPACITY];
+static bt_addr_le_t peer_addrs[CONFIG_BL_PEER_CAPACITY];
+static uint16_t peer_count;
+
+static const struct hw_id_index table_index = HW_ID_INDEX_INIT(table, peer_ids);
+
+static struct k_spinlock table_lock;
+
+static void aging_work_handle(struct k_work *item);
+static K_WORK_DELAYABLE_DEFINE(aging_work, aging_work_handle);
+
+static inline bool slot_used(uint32_t slot)
+{
+	return hw_id_index_get(&table_index, slot) != HW_ID_INDEX_NONE;
+}
+
+static inline bool peer_expired(uint16_t idx, uint32_t now)
+{
+	return (int32_t)(now - peer_seen_ms[idx]) >= CONFIG_BL_PEER_TIMEOUT_MS;
+}
+
+/* Moves the last peer into the freed index to keep the arrays dense */
+static void peer_remove(uint16_t idx)
+{
+	uint16_t last = peer_count - 1;
+
+	hw_id_index_remove(&table_index, hw_id_index_find(&table_index, peer_ids[idx]));
+
+	if (idx != last) {
+		hw_id_index_set(&table_index, hw_id_index_find(&table_index, peer_ids[last]), idx);
+		peer_ids[idx] = peer_ids[last];
+		peer_seen_ms[idx] = peer_seen_ms[last];
+		peer_rssi_q8[idx] = peer_rssi_q8[last];
+		bt_addr_le_copy(&peer_addrs[idx], &peer_addrs[last]);
+	}
+
+	peer_count--;
+}
+
+static void peer_copy(uint16_t idx, struct peer_entry *entry)
+{
+	bt_addr_le_copy(&entry->bt_addr, &peer_addrs[idx]);
+	entry->hw_id = peer_ids[idx];
+	entry->last_seen_ms = peer_seen_ms[idx];
+	entry->timeout_ms = CONFIG_BL_PEER_TIMEOUT_MS;
+	entry->rssi_q8 = peer_rssi_q8[idx];
+}
+
+static void aging_work_handle(struct k_work *item)
+{
+	uint32_t now = k_uptime_get_32();
+	int32_t next_expiry = INT32_MAX;
+	size_t removed = 0;
+	size_t remaining;
+
+	k_spinlock_key_t key = k_spin_lock(&table_lock);
+
+	for (uint16_t idx = 0; idx < peer_count; ) {
+		if (peer_expired(idx, now)) {
+			/* Re-check the index, the last peer moved into it */
+			peer_remove(idx);
+			removed++;
+			continue;
+		}
+
+		int32_t left = CONFIG_BL_PEER_TIMEOUT_MS - (int32_t)(now - peer_seen_ms[idx]);
+
+		next_expiry = MIN(next_expiry, left);
+		idx++;
+	}
+
+	remaining = peer_count;
+	k_spin_unlock(&table_lock, key);
+
+	if (removed) {
+		LOG_DBG("Aged out %zu peers, %zu remaining", removed, remaining);
+	}
+
+	/* A single timer serves the whole table, armed for the nearest expiry */
+	if (remaining) {
+		k_work_reschedule(&aging_work, K_MSEC(MAX(next_expiry, 1)));
+	}
+}
+
+int peer_table_init(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&table_lock);
+
+	hw_id_index_clear(&table_index);
+	peer_count = 0;
+
+	k_spin_unlock(&table_lock, key);
+
+	return 0;
+}
+
+int peer_table_update(const bt_addr_le_t *addr, uint64_t hw_id, int8_t rssi)
+{
+	int16_t rssi_q8 = (int16_t)rssi * 256;
+	uint32_t now = k_uptime_get_32();
+	int ret = 0;
+
+	k_spinlock_key_t key = k_spin_lock(&table_lock);
+
+	uint32_t slot = hw_id_index_find(&table_index, hw_id);
+	uint16_t idx;
+
+	if (!slot_used(slot)) {
+		if (peer_count >= CONFIG_BL_PEER_CAPACITY) {
+			k_spin_unlock(&table_lock, key);
+			return -ENOMEM;
+		}
+
+		idx = peer_count++;
+		hw_id_index_set(&table_index, slot, idx);
+		peer_ids[idx] = hw_id;
+		peer_rssi_q8[idx] = rssi_q8;
+		ret = 1;
+	} else {
+		idx = hw_id_index_get(&table_index, slot);
+	}
+
+	bt_addr_le_copy(&peer_addrs[idx], addr);
+	peer_seen_ms[idx] = now;
+	/* Arithmetic shift keeps the sign, both terms fit in int16_t */
+	peer_rssi_q8[idx] += (rssi_q8 - peer_rssi_q8[idx]) >> RSSI_EMA_SHIFT;
+
+	k_spin_unlock(&table_lock, key);
+
+	if (ret == 1) {
+		/* Does nothing if the timer is already armed for an earlier expiry */
+		k_work_schedule(&aging_work, K_MSEC(CONFIG_BL_PEER_TIMEOUT_MS));
+	}
+
+	return ret;
+}
+
+bool peer_table_get(uint64_t hw_id, struct peer_entry *entry)
+{
+	bool found;
+
+	k_spinlock_key_t key = k_spin_lock(&table_lock);
+
+	uint32_t slot = hw_id_index_find(&table_index, hw_id);
+
+	found = slot_used(slot);
+	if (found && entry) {
+		peer_copy(hw_id_index_get(&table_index, slot), entry);
+	}
+
+	k_spin_unlock(&table_lock, key);
+
+	return found;
+}
+
+size_t peer_table_count(void)
+{
+	return peer_count;
+}
+
+/* Min-heap of peer indices on their RSSI, the root is the weakest of the
+ * strongest n so far.
+ */
+static void heap_sift_down(uint16_t *heap, size_t count, size_t i)
+{
+	while (true) {
+		size_t min = i;
+		size_t left = 2 * i + 1;
+		size_t right = left + 1;
+
+		if (left < count && peer_rssi_q8[heap[left]] < peer_rssi_q8[heap[min]]) {
+			min = left;
+		}
+		if (right < count && peer_rssi_q8[heap[right]] < peer_rssi_q8[heap[min]]) {
+			min = right;
+		}
+		if (min == i) {
+			return;
+		}
+
+		uint16_t tmp = heap[i];
+
+		heap[i] = heap[min];
+		heap[min] = tmp;
+		i = min;
+	}
+}
+
+static void heap_sift_up(uint16_t *heap, size_t i)
+{
+	while (i > 0) {
+		size_t parent = (i - 1) / 2;
+
+		if (peer_rssi_q8[heap[parent]] <= peer_rssi_q8[heap[i]]) {
+			return;
+		}
+
+		uint16_t tmp = heap[i];
+
+		heap[i] = heap[parent];
+		heap[parent] = tmp;
+		i = parent;
+	}
+}
+
+size_t peer_table_nearest(struct peer_entry *out, size_t n)
+{
+	uint16_t heap[CONFIG_BL_PEER_NEAREST_MAX];
+	size_t count = 0;
+
+	n = MIN(n, ARRAY_SIZE(heap));
+	if (n == 0) {
+		return 0;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&table_lock);
+
+	/* Only the RSSI array is walked */
+	for (uint16_t idx = 0; idx < peer_count; idx++) {
+		if (count < n) {
+			heap[count] = idx;
+			heap_sift_up(heap, count++);
+		} else if (peer_rssi_q8[idx] > peer_rssi_q8[heap[0]]) {
+			heap[0] = idx;
+			heap_sift_down(heap, count, 0);
+		}
+	}
+
+	/* Heap sort the indices in place, strongest first */
+	for (size_t end = count; end > 1; end--) {
+		uint16_t tmp = heap[0];
+
+		heap[0] = heap[end - 1];
+		heap[end - 1] = tmp;
+		heap_sift_down(heap, end - 1, 0);
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		peer_copy(heap[i], &out[i]);
+	}
+
+	k_spin_unlock(&table_lock, key);
+
+	return count;
+}
+
+void peer_table_foreach(peer_table_cb_t cb, void *user_data)
+{
+	struct peer_entry entry;
+
+	/* Removals move the last peer down, a peer aged out meanwhile may be
+	 * skipped or visited twice.
+	 */
+	for (uint16_t idx = 0; ; idx++) {
+		bool valid;
+
+		k_spinlock_key_t key = k_spin_lock(&table_lock);
+
+		valid = idx < peer_count;
+		if (valid) {
+			peer_copy(idx, &entry);
+		}
+
+		k_spin_unlock(&table_lock, key);
+
+		if (!valid || !cb(&entry, user_data)) {
+			return;
+		}
+	}
+}
@@ -0,0 +1,129 @@
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/random/random.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(prov_uuid_cache, LOG_LEVEL_DBG);
+
+#include "fake_kconfig.h"
+
+#include "prov_uuid_cache.h"
+
+enum cache_state {
+	CACHE_STATE_FREE,
+	CACHE_STATE_PROVISIONED,
+	CACHE_STATE_FAILED,
+};
+
+struct cache_entry {
+	uint8_t uuid[16];
+	uint32_t updated_ms;
+	uint32_t retry_at_ms;
+	uint8_t state;
+	uint8_t failures;
+};
+
+static struct cache_entry cache[CONFIG_BL_MESH_PROV_UUID_CACHE_SIZE];
+static struct k_spinlock cache_lock;
+
+static struct cache_entry *cache_find(const uint8_t uuid[16])
+{
+	for (size_t i = 0; i < ARRAY_SIZE(cache); i++) {
+		if (cache[i].state != CACHE_STATE_FREE && !memcmp(cache[i].uuid, uuid, 16)) {
+			return &cache[i];
+		}
+	}
+
+	return NULL;
+}
+
+/* Free slot, or the least recently updated one */
+static struct cache_entry *cache_alloc(const uint8_t uuid[16])
+{
+	struct cache_entry *oldest = &cache[0];
+	uint32_t now = k_uptime_get_32();
+
+	for (size_t i = 0; i < ARRAY_SIZE(cache); i++) {
+		if (cache[i].state == CACHE_STATE_FREE) {
+			oldest = &cache[i];
+			break;
+		}
+		if (now - cache[i].updated_ms > now - oldest->updated_ms) {
+			oldest = &cache[i];
+		}
+	}
+
+	memcpy(oldest->uuid, uuid, 16);
+	oldest->failures = 0;
+	return oldest;
+}
+
+static uint32_t backoff_ms(uint8_t failures)
+{
+	uint32_t delay = CONFIG_BL_MESH_PROV_BACKOFF_BASE_MS;
+
+	for (uint8_t i = 1; i < failures && delay < CONFIG_BL_MESH_PROV_BACKOFF_MAX_MS; i++) {
+		delay <<= 1;
+	}
+	delay = MIN(delay, CONFIG_BL_MESH_PROV_BACKOFF_MAX_MS);
+
+	/* Up to 50% jitter so that failed devices do not retry in lockstep */
+	return delay + sys_rand32_get() % (delay / 2 + 1);
+}
+
+bool prov_uuid_cache_allowed(const uint8_t uuid[16])
+{
+	bool allowed = true;
+
+	k_spinlock_key_t key = k_spin_lock(&cache_lock);
+
+	struct cache_entry *entry = cache_find(uuid);
+
+	if (entry) {
+		if (entry->state == CACHE_STATE_PROVISIONED) {
+			allowed = false;
+		} else if ((int32_t)(k_uptime_get_32() - entry->retry_at_ms) < 0) {
+			allowed = false;
+		}
+	}
+
+	k_spin_unlock(&cache_lock, key);
+
+	return allowed;
+}
+
+void prov_uuid_cache_record(const uint8_t uuid[16], bool success)
+{
+	uint32_t now = k_uptime_get_32();
+	uint32_t delay = 0;
+	uint8_t failures = 0;
+
+	k_spinlock_key_t key = k_spin_lock(&cache_lock);
+
+	struct cache_entry *entry = cache_find(uuid);
+
+	if (!entry) {
+		entry = cache_alloc(uuid);
+	}
+
+	entry->updated_ms = now;
+	if (success) {
+		entry->state = CACHE_STATE_PROVISIONED;
+		entry->failures = 0;
+	} else {
+		entry->state = CACHE_STATE_FAILED;
+		if (entry->failures < UINT8_MAX) {
+			entry->failures++;
+		}
+		failures = entry->failures;
+		delay = backoff_ms(failures);
+		entry->retry_at_ms = now + delay;
+	}
+
+	k_spin_unlock(&cache_lock, key);
+
+	if (!success) {
+		LOG_DBG("Attempt %u failed, backing off %u ms", failures, delay);
+	}
+}
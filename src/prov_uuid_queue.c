@@ -0,0 +1,79 @@
+#include <string.h>
+
+#include <zephyr/kernel.h>
+
+#include "fake_kconfig.h"
+
+#include "prov_uuid_queue.h"
+
+#define QUEUE_SIZE CONFIG_BL_MESH_PROV_UUID_QUEUE_SIZE
+
+static uint8_t queue[QUEUE_SIZE][16];
+static size_t queue_head;
+static size_t queue_count;
+static struct k_spinlock queue_lock;
+
+/* Linear dedup is fine, the queue is small and beacons are slow */
+static bool queue_contains(const uint8_t uuid[16])
+{
+	for (size_t i = 0; i < queue_count; i++) {
+		if (!memcmp(queue[(queue_head + i) % QUEUE_SIZE], uuid, 16)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int prov_uuid_queue_push(const uint8_t uuid[16])
+{
+	int err = 0;
+
+	k_spinlock_key_t key = k_spin_lock(&queue_lock);
+
+	if (queue_contains(uuid)) {
+		err = -EALREADY;
+	} else if (queue_count == QUEUE_SIZE) {
+		err = -ENOMEM;
+	} else {
+		memcpy(queue[(queue_head + queue_count) % QUEUE_SIZE], uuid, 16);
+		queue_count++;
+	}
+
+	k_spin_unlock(&queue_lock, key);
+
+	return err;
+}
+
+bool prov_uuid_queue_pop(uint8_t uuid[16])
+{
+	bool found = false;
+
+	k_spinlock_key_t key = k_spin_lock(&queue_lock);
+
+	if (queue_count) {
+		memcpy(uuid, queue[queue_head], 16);
+		queue_head = (queue_head + 1) % QUEUE_SIZE;
+		queue_count--;
+		found = true;
+	}
+
+	k_spin_unlock(&queue_lock, key);
+
+	return found;
+}
+
+size_t prov_uuid_queue_count(void)
+{
+	return queue_count;
+}
+
+void prov_uuid_queue_clear(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&queue_lock);
+
+	queue_head = 0;
+	queue_count = 0;
+
+	k_spin_unlock(&queue_lock, key);
+}
@@ -1,53 +1,76 @@
 #include <zephyr/bluetooth/mesh.h>
 #include <zephyr/bluetooth/mesh/cfg_cli.h>
+#include <zephyr/sys/byteorder.h>
 
 #include "fake_kconfig.h"
 
 #include "hw_config.h"
 #include "provisioning.h"
+#include "prov_uuid_queue.h"
+#include "prov_uuid_cache.h"
+#include "node_config.h"
+#include "bench.h"
+#include "boot.h"
+#include "scan_sched.h"
+#include "trace.h"
 
 /* TODO: Parametrized logging */
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(provisioning, LOG_LEVEL_DBG);
 
-K_SEM_DEFINE(sem_unprov_beacon, 0, 1);
-K_SEM_DEFINE(sem_node_added, 0, 1);
+/* Provisioning state machine, only touched from the system work queue.
+ * Mesh callbacks post events, each state has its own timeout.
+ */
+enum prov_state {
+	PROV_STATE_IDLE,
+	PROV_STATE_BEACON_SEEN,
+	PROV_STATE_LINK_OPEN,
+	PROV_STATE_NODE_ADDED,
+	PROV_STATE_CONFIGURING,
+};
+
+enum prov_event {
+	PROV_EVT_BEACON,
+	PROV_EVT_LINK_OPEN,
+	PROV_EVT_LINK_CLOSE,
+	PROV_EVT_NODE_ADDED,
+	PROV_EVT_TIMEOUT,
 
-K_THREAD_STACK_DEFINE(provisioning_stack_area, CONFIG_BL_MESH_PROVISIONING_STACK_SIZE);
-struct k_work_q provisioning_queue = { 0 };
-const struct k_work_queue_config cfg = {
-	.name = "provisioning_queue",
-	.no_yield = false,
+	PROV_EVT_COUNT,
 };
 
+static enum prov_state prov_state = PROV_STATE_CONFIGURING;
+static ATOMIC_DEFINE(prov_events, PROV_EVT_COUNT);
+
+static void provisioning_work_cb(struct k_work *item);
+static void provisioning_timeout_cb(struct k_work *item);
+K_WORK_DEFINE(provisioning_work, provisioning_work_cb);
+K_WORK_DELAYABLE_DEFINE(provisioning_timeout, provisioning_timeout_cb);
+
 static uint16_t self_addr = 1;
 static uint16_t node_addr = 0;
 static uint8_t node_uuid[16];
-static const uint8_t prov_dev_uuid[16] = { 0xdd, 0xdd };
+
+/* Set once this device acts as provisioner */
+static bool started;
+/* Set while the CDB is handed over, the state machine leaves it alone */
+static bool paused;
 
 static const uint16_t net_idx;
 static const uint16_t app_idx;
 
-/* Models */
-static struct bt_mesh_cfg_cli cfg_cli = { 0 };
-static const struct bt_mesh_model sig_models[] = {
-	BT_MESH_MODEL_CFG_SRV,
-	BT_MESH_MODEL_CFG_CLI(&cfg_cli),
-};
-
-static struct bt_mesh_model vnd_models[] = { };
-
-static const struct bt_mesh_elem elements[] = {
-	BT_MESH_ELEM(0, sig_models, vnd_models),
-};
-
-const struct bt_mesh_comp provisioner_mesh_comp = {
-	.cid = CONFIG_BL_COMPOSITION_COMPANY_ID,
-	.elem = elements,
-	.elem_count = ARRAY_SIZE(elements),
-};
+/* Nodes waiting for a configuration job, only touched from the provisioning
+ * queue. Seeded once from the CDB, then fed by node_added and failed
+ * configurations so the periodic pass does not walk the whole CDB.
+ */
+static uint16_t unconfigured[CONFIG_BT_MESH_CDB_NODE_COUNT];
+static size_t unconfigured_head;
+static size_t unconfigured_count;
+static bool unconfigured_seeded;
 
 /* Provisioning */
+static void provisining_link_open(enum bt_mesh_prov_bearer bearer);
+static void provisining_link_close(enum bt_mesh_prov_bearer bearer);
 static void provisining_unprovisioned_beacon(
     uint8_t uuid[16],
 	bt_mesh_prov_oob_info_t oob_info,
@@ -59,21 +82,59 @@ static void provisining_node_added(
     uint16_t addr,
     uint8_t num_elem
 );
+static void provisioning_node_configured(uint16_t addr, int err);
 
+/* Forwarded by role.c while this device is provisioner */
 const struct bt_mesh_prov provisioner_prov = {
-	.uuid = prov_dev_uuid,
+	.link_open = provisining_link_open,
+	.link_close = provisining_link_close,
 	.unprovisioned_beacon = provisining_unprovisioned_beacon,
 	.node_added = provisining_node_added,
 };
 
+static void provisioning_event_post(enum prov_event evt)
+{
+	atomic_set_bit(prov_events, evt);
+	k_work_submit(&provisioning_work);
+}
+
+static void provisining_link_open(enum bt_mesh_prov_bearer bearer)
+{
+	provisioning_event_post(PROV_EVT_LINK_OPEN);
+}
+
+static void provisining_link_close(enum bt_mesh_prov_bearer bearer)
+{
+	provisioning_event_post(PROV_EVT_LINK_CLOSE);
+}
+
 
 static void provisining_unprovisioned_beacon(
     uint8_t uuid[16],
 	bt_mesh_prov_oob_info_t oob_info,
 	uint32_t *uri_hash
 ) {
-	memcpy(node_uuid, uuid, 16);
-	k_sem_give(&sem_unprov_beacon);
+	/* Devices keep beaconing until the link opens, skip the one in progress */
+	if (!memcmp(node_uuid, uuid, 16)) {
+		return;
+	}
+
+	/* Already provisioned or backing off after a failure */
+	if (!prov_uuid_cache_allowed(uuid)) {
+		return;
+	}
+
+	int err = prov_uuid_queue_push(uuid);
+	if (err == -ENOMEM) {
+		LOG_WRN("Provisioning queue full, dropping beacon");
+		return;
+	}
+	if (err) {
+		return;
+	}
+
+	scan_sched_kick();
+	provisioning_event_post(PROV_EVT_BEACON);
 }
 
 static void provisining_node_added(
@@ -83,7 +144,7 @@ static void provisining_node_added(
     uint8_t num_elem
 ) {
 	node_addr = addr;
-	k_sem_give(&sem_node_added);
+	provisioning_event_post(PROV_EVT_NODE_ADDED);
 }
 
 static void setup_cdb(void)
@@ -106,245 +167,286 @@ static void setup_cdb(void)
 		return;
 	}
 
+	#if IS_ENABLED(CONFIG_SENSIBLE_DATA)
+		LOG_HEXDUMP_INF(app_key, ARRAY_SIZE(app_key), "Appkey is ");
+	#endif
+
 	if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
 		bt_mesh_cdb_app_key_store(key);
 	}
 }
 
-/* Init */
-int provisining_init()
+/* Init. The state machine and the node configuration share the system work
+ * queue, every step is short and the Configuration Client is used without
+ * waiting for responses, so no device reserves a stack for the provisioner.
+ */
+static int provisining_init()
 {
 	int err = 0;
 
-	/* UUID must be set by now */
-	memcpy(dev_uuid, provisioner_prov.uuid, 16);
+	if (started) {
+		return 0;
+	}
+
+	err = node_config_init(&k_sys_work_q, net_idx, app_idx, provisioning_node_configured);
+	if (err) {
+		LOG_ERR("Failed to init node configuration (err %d)", err);
+		return err;
+	}
 
-	k_work_queue_init(&provisioning_queue);
-	k_work_queue_start(
-		&provisioning_queue,
-		provisioning_stack_area,
-		K_THREAD_STACK_SIZEOF(provisioning_stack_area),
-		CONFIG_BL_MESH_PROVISIONING_PRIORITY,
-		&cfg
-	);
+	started = true;
 
 	return 0;
 }
 
-/* Configuration loop */
-static void configure_node(struct bt_mesh_cdb_node *node)
+/* Configuration */
+static void provisioning_unconfigured_push(uint16_t addr)
 {
-	NET_BUF_SIMPLE_DEFINE(buf, BT_MESH_RX_SDU_MAX);
-	struct bt_mesh_comp_p0_elem elem;
-	struct bt_mesh_cdb_app_key *key;
-	uint8_t app_key[16];
-	struct bt_mesh_comp_p0 comp;
-	uint8_t status;
-	int err, elem_addr;
-
-	LOG_DBG("Configuring node 0x%04x...", node->addr);
-
-	key = bt_mesh_cdb_app_key_get(app_idx);
-	if (key == NULL) {
-		LOG_ERR("No app-key 0x%04x", app_idx);
-		return;
+	for (size_t i = 0; i < unconfigured_count; i++) {
+		if (unconfigured[(unconfigured_head + i) % ARRAY_SIZE(unconfigured)] == addr) {
+			return;
+		}
 	}
 
-	err = bt_mesh_cdb_app_key_export(key, 0, app_key);
-	if (err) {
-		LOG_ERR("Failed to export appkey from cdb. Err:%d", err);
+	if (unconfigured_count == ARRAY_SIZE(unconfigured)) {
+		/* Cannot happen as long as every entry is a CDB node */
+		LOG_WRN("Unconfigured list full, dropping 0x%04x", addr);
 		return;
 	}
 
-	/* Add Application Key */
-	err = bt_mesh_cfg_cli_app_key_add(net_idx, node->addr, net_idx, app_idx, app_key, &status);
-	if (err || status) {
-		LOG_ERR("Failed to add app-key (err %d status %d)", err, status);
-		return;
-	}
+	unconfigured[(unconfigured_head + unconfigured_count) % ARRAY_SIZE(unconfigured)] = addr;
+	unconfigured_count++;
+}
 
-	/* Get the node's composition data and bind all models to the appkey */
-	err = bt_mesh_cfg_cli_comp_data_get(net_idx, node->addr, 0, &status, &buf);
-	if (err || status) {
-		LOG_ERR("Failed to get Composition data (err %d, status: %d)",
-		       err, status);
+static void provisioning_node_configured(uint16_t addr, int err)
+{
+	struct bt_mesh_cdb_node *node = bt_mesh_cdb_node_get(addr);
+
+	if (node == NULL) {
 		return;
 	}
 
-	err = bt_mesh_comp_p0_get(&comp, &buf);
+	/* Failed nodes are retried on the idle period */
 	if (err) {
-		LOG_ERR("Unable to parse composition data (err: %d)", err);
+		provisioning_unconfigured_push(addr);
 		return;
 	}
 
-	elem_addr = node->addr;
-	while (bt_mesh_comp_p0_elem_pull(&comp, &elem)) {
-		LOG_DBG("Element @ 0x%04x: %u + %u models", elem_addr,
-		       elem.nsig, elem.nvnd);
-		for (int i = 0; i < elem.nsig; i++) {
-			uint16_t id = bt_mesh_comp_p0_elem_mod(&elem, i);
+	atomic_set_bit(node->flags, BT_MESH_CDB_NODE_CONFIGURED);
+	bench_node_configured(addr);
 
-			if (id == BT_MESH_MODEL_ID_CFG_CLI ||
-			    id == BT_MESH_MODEL_ID_CFG_SRV) {
-				continue;
-			}
-			LOG_DBG("Binding AppKey to model 0x%03x:%04x",
-			       elem_addr, id);
-
-			err = bt_mesh_cfg_cli_mod_app_bind(
-				net_idx,
-				node->addr,
-				elem_addr,
-				app_idx,
-				id,
-				&status
-			);
-			if (err || status) {
-				LOG_ERR(
-					"Failed to bind SIG model %d (err: %d, status: %d)", id, err, status
-				);
-			}
-		}
+	if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
+		bt_mesh_cdb_node_store(node);
+	}
+}
 
-		for (int i = 0; i < elem.nvnd; i++) {
-			struct bt_mesh_mod_id_vnd id = bt_mesh_comp_p0_elem_mod_vnd(&elem, i);
+/* Hands pending nodes to the configuration engine until its slots are full */
+static void provisioning_configure_pending(void)
+{
+	while (unconfigured_count) {
+		uint16_t addr = unconfigured[unconfigured_head];
+		struct bt_mesh_cdb_node *node = bt_mesh_cdb_node_get(addr);
+		int err = 0;
 
-			LOG_DBG("Binding AppKey to model 0x%03x:%04x:%04x",
-			       elem_addr, id.company, id.id);
+		if (node && !atomic_test_bit(node->flags, BT_MESH_CDB_NODE_CONFIGURED)) {
+			struct comp_cache_key product;
+			bool tagged = comp_cache_key_from_uuid(node->uuid, &product);
 
-			err = bt_mesh_cfg_cli_mod_app_bind_vnd(net_idx, node->addr, elem_addr,
-							       app_idx, id.id, id.company, &status);
-			if (err || status) {
-				LOG_ERR(
-					"Failed to bind vnd model %d (company %d) (err: %d, status: %d)",
-					id.id, id.company, err, status
-				);
-				continue;
-			}
+			err = node_config_add(addr, tagged ? &product : NULL);
 		}
 
-		elem_addr++;
-	}
+		if (err == -ENOMEM) {
+			/* Picked up again once a job slot frees up */
+			break;
+		}
 
-	atomic_set_bit(node->flags, BT_MESH_CDB_NODE_CONFIGURED);
+		unconfigured_head = (unconfigured_head + 1) % ARRAY_SIZE(unconfigured);
+		unconfigured_count--;
+	}
+}
 
-	if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
-		bt_mesh_cdb_node_store(node);
+static uint8_t provisioning_check_unconfigured(struct bt_mesh_cdb_node *node, void *data)
+{
+	if (!atomic_test_bit(node->flags, BT_MESH_CDB_NODE_CONFIGURED)) {
+		provisioning_unconfigured_push(node->addr);
 	}
 
-	LOG_DBG("Configuration complete");
+	return BT_MESH_CDB_ITER_CONTINUE;
 }
 
-static void configure_self(struct bt_mesh_cdb_node *self)
-{
-	struct bt_mesh_cdb_app_key *key;
-	uint8_t app_key[16];
-	uint8_t status = 0;
-	int err;
+struct uuid_match {
+	const uint8_t *uuid;
+	bool found;
+};
 
-	LOG_DBG("Configuring self...");
+static uint8_t provisioning_match_uuid(struct bt_mesh_cdb_node *node, void *data)
+{
+	struct uuid_match *match = data;
 
-	key = bt_mesh_cdb_app_key_get(app_idx);
-	if (key == NULL) {
-		LOG_ERR("No app-key 0x%04x", app_idx);
-		return;
+	if (!memcmp(node->uuid, match->uuid, 16)) {
+		match->found = true;
+		return BT_MESH_CDB_ITER_STOP;
 	}
 
-	err = bt_mesh_cdb_app_key_export(key, 0, app_key);
-	if (err) {
-		LOG_ERR("Failed to export appkey from cdb. Err:%d", err);
-		return;
-	}
+	return BT_MESH_CDB_ITER_CONTINUE;
+}
 
-	#if IS_ENABLED(CONFIG_SENSIBLE_DATA)
-		LOG_HEXDUMP_INF(app_key, ARRAY_SIZE(app_key), "Appkey is ");
-	#endif
+static bool provisioning_in_cdb(const uint8_t uuid[16])
+{
+	struct uuid_match match = { .uuid = uuid, .found = false };
 
-	/* Add Application Key */
-	err = bt_mesh_cfg_cli_app_key_add(
-		self->net_idx, self->addr, self->net_idx, app_idx,app_key, &status
-	);
-	if (err || status) {
-		LOG_ERR(
-			"Failed to add app-key (err %d, status %d)", err, status
-		);
-		return;
-	}
+	bt_mesh_cdb_node_foreach(provisioning_match_uuid, &match);
 
-	atomic_set_bit(self->flags, BT_MESH_CDB_NODE_CONFIGURED);
+	return match.found;
+}
 
-	if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
-		bt_mesh_cdb_node_store(self);
-	}
+static uint8_t provisioning_seed_cache(struct bt_mesh_cdb_node *node, void *data)
+{
+	prov_uuid_cache_record(node->uuid, true);
+	return BT_MESH_CDB_ITER_CONTINUE;
+}
 
-	LOG_DBG("Configuration complete");
+static void provisioning_state_set(enum prov_state state, uint32_t timeout_ms)
+{
+	prov_state = state;
+	k_work_reschedule(&provisioning_timeout, K_MSEC(timeout_ms));
 }
 
-static uint8_t provisioning_check_unconfigured(struct bt_mesh_cdb_node *node, void *data)
+static void provisioning_attempt_failed(const char *reason)
 {
-	if (!atomic_test_bit(node->flags, BT_MESH_CDB_NODE_CONFIGURED)) {
-		if (node->addr == self_addr) {
-			configure_self(node);
+	LOG_DBG("Provisioning failed (%s)", reason);
+	prov_uuid_cache_record(node_uuid, false);
+	memset(node_uuid, 0, sizeof(node_uuid));
+	provisioning_state_set(PROV_STATE_IDLE, CONFIG_BL_MESH_PROV_IDLE_PERIOD_MS);
+}
+
+/* Pops queued devices until one provisioning attempt is started */
+static void provisioning_next(void)
+{
+	char uuid_hex_str[32 + 1] = { 0 };
+	int err;
+
+	while (prov_uuid_queue_pop(node_uuid)) {
+		if (provisioning_in_cdb(node_uuid)) {
+			prov_uuid_cache_record(node_uuid, true);
+			continue;
+		}
+
+		if (TRACE_ENABLED(PROV)) {
+			TRACE(PROV, TRACE_EVT_PROV_START, 0,
+			      sys_get_le32(&node_uuid[0]), sys_get_le32(&node_uuid[4]));
 		} else {
-			configure_node(node);
+			bin2hex(node_uuid, 16, uuid_hex_str, sizeof(uuid_hex_str));
+			LOG_DBG("Provisioning %s", uuid_hex_str);
 		}
+
+		err = bt_mesh_provision_adv(node_uuid, net_idx, 0, 0);
+		if (err == -EBUSY) {
+			/* A previous link is still closing, retry on link close */
+			prov_uuid_queue_push(node_uuid);
+			break;
+		}
+		if (err < 0) {
+			if (TRACE_ENABLED(PROV)) {
+				TRACE(PROV, TRACE_EVT_PROV_FAILED, 0, err, sys_get_le32(&node_uuid[0]));
+			} else {
+				LOG_DBG("Provisioning failed (err %d)", err);
+			}
+			prov_uuid_cache_record(node_uuid, false);
+			continue;
+		}
+
+		provisioning_state_set(PROV_STATE_BEACON_SEEN, CONFIG_BL_MESH_PROV_LINK_TIMEOUT_MS);
+		return;
 	}
 
-	return BT_MESH_CDB_ITER_CONTINUE;
+	memset(node_uuid, 0, sizeof(node_uuid));
 }
 
-static int provisioning_step(void) {
-    char uuid_hex_str[32 + 1] = { 0 };
-    
-	k_sem_reset(&sem_unprov_beacon);
-	k_sem_reset(&sem_node_added);
-	bt_mesh_cdb_node_foreach(provisioning_check_unconfigured, NULL);
+static void provisioning_work_cb(struct k_work *item) {
+	/* Events stay pending until resumed */
+	if (paused) {
+		return;
+	}
+
+	atomic_val_t events = atomic_clear(prov_events);
+	bool in_attempt = prov_state == PROV_STATE_BEACON_SEEN ||
+			  prov_state == PROV_STATE_LINK_OPEN;
 
-	LOG_DBG("Waiting for unprovisioned beacon...");
-	int err = k_sem_take(&sem_unprov_beacon, K_SECONDS(10));
-	if (err < 0) {
-		return err;
+	if (prov_state == PROV_STATE_BEACON_SEEN && (events & BIT(PROV_EVT_LINK_OPEN))) {
+		provisioning_state_set(PROV_STATE_LINK_OPEN, CONFIG_BL_MESH_PROV_TIMEOUT_MS);
+	}
+
+	if (in_attempt && (events & BIT(PROV_EVT_NODE_ADDED))) {
+		if (TRACE_ENABLED(PROV)) {
+			TRACE(PROV, TRACE_EVT_PROV_ADDED, node_addr, 0, 0);
+		} else {
+			LOG_DBG("Added node 0x%04x", node_addr);
+		}
+		prov_uuid_cache_record(node_uuid, true);
+		provisioning_unconfigured_push(node_addr);
+		/* Wait for the link to close before opening the next one */
+		provisioning_state_set(PROV_STATE_NODE_ADDED, CONFIG_BL_MESH_PROV_LINK_TIMEOUT_MS);
+		in_attempt = false;
 	}
 
-	bin2hex(node_uuid, 16, uuid_hex_str, sizeof(uuid_hex_str));
+	if (events & (BIT(PROV_EVT_LINK_CLOSE) | BIT(PROV_EVT_TIMEOUT))) {
+		if (in_attempt) {
+			provisioning_attempt_failed(
+				events & BIT(PROV_EVT_LINK_CLOSE) ? "link closed" : "timeout"
+			);
+		} else if (prov_state == PROV_STATE_NODE_ADDED ||
+			   (prov_state == PROV_STATE_IDLE && (events & BIT(PROV_EVT_TIMEOUT)))) {
+			/* New node, or periodic retry of nodes that failed configuration */
+			prov_state = PROV_STATE_CONFIGURING;
+		}
+	}
 
-	LOG_DBG("Provisioning %s", uuid_hex_str);
-	err = bt_mesh_provision_adv(node_uuid, net_idx, 0, 0);
-	if (err < 0) {
-		LOG_DBG("Provisioning failed (err %d)", err);
-		return err;
+	if (prov_state == PROV_STATE_CONFIGURING) {
+		memset(node_uuid, 0, sizeof(node_uuid));
+		if (!unconfigured_seeded) {
+			/* The only full CDB walk, picks up nodes stored unconfigured */
+			bt_mesh_cdb_node_foreach(provisioning_check_unconfigured, NULL);
+			unconfigured_seeded = true;
+		}
+		provisioning_configure_pending();
+		provisioning_state_set(PROV_STATE_IDLE, CONFIG_BL_MESH_PROV_IDLE_PERIOD_MS);
 	}
 
-	LOG_DBG("Waiting for node to be added...");
-	err = k_sem_take(&sem_node_added, K_SECONDS(10));
-	if (err < 0) {
-		LOG_DBG("Timeout waiting for node to be added (err: %d)", err);
-		return err;
+	if (prov_state == PROV_STATE_IDLE) {
+		provisioning_next();
 	}
+}
 
-	LOG_DBG("Added node 0x%04x", node_addr);
-	return 0;
+static void provisioning_timeout_cb(struct k_work *item) {
+	/* Runs on the system work queue as well, no race with the state machine */
+	atomic_set_bit(prov_events, PROV_EVT_TIMEOUT);
+	provisioning_work_cb(&provisioning_work);
 }
 
-static void provisioning_work_cb(struct k_work *item) {
-	struct k_work_delayable *dwork = k_work_delayable_from_work(item);
-	provisioning_step();
-	int error_code = k_work_reschedule_for_queue(&provisioning_queue, dwork, K_SECONDS(5));
-	if(error_code < 0) {
-		LOG_ERR("Failed to reschedule provisioning work (err %d)", error_code);
+static int provisioning_run(void)
+{
+	/* Devices in a stored CDB must not be provisioned again */
+	bt_mesh_cdb_node_foreach(provisioning_seed_cache, NULL);
+	unconfigured_seeded = false;
+
+	int error_code = k_work_submit(&provisioning_work);
+	if (error_code < 0) {
+		LOG_ERR("Failed to submit provisioning work (err %d)", error_code);
+		return error_code;
 	}
+	return 0;
 }
 
-K_WORK_DELAYABLE_DEFINE(provisioning_work, provisioning_work_cb);
-
 int provisioning_start(void) {
 
 	uint8_t net_key[16] = {0};
     uint8_t dev_key[16] = {0};
 
-	if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
-		LOG_INF("Loading stored settings");
-		settings_load();
+	int err = provisining_init();
+	if (err) {
+		LOG_ERR("Provisioning init failed (err %d)", err);
+		return err;
 	}
 
 	bt_rand(net_key, 16);
@@ -356,7 +458,7 @@ int provisioning_start(void) {
 		LOG_HEXDUMP_INF(net_key, ARRAY_SIZE(net_key), "Netkey is ");
 	#endif
 
-	int err = bt_mesh_cdb_create(net_key);
+	err = bt_mesh_cdb_create(net_key);
 	if (err == -EALREADY) {
 		LOG_DBG("Using stored CDB");
 	} else if (err) {
@@ -391,11 +493,48 @@ int provisioning_start(void) {
 	} else {
 		LOG_DBG("Provisioning completed");
 	}
+	boot_mark(BOOT_PROVISIONED);
 
-	int error_code = k_work_schedule_for_queue(&provisioning_queue, &provisioning_work, K_NO_WAIT);
-	if (error_code < 0) {
-		LOG_ERR("Failed to submit provisioning work (err %d)", error_code);
-		return error_code;
+	return provisioning_run();
+}
+
+int provisioning_takeover(void)
+{
+	struct bt_mesh_cdb_node *self = bt_mesh_cdb_node_get(bt_mesh_primary_addr());
+
+	int err = provisining_init();
+	if (err) {
+		LOG_ERR("Provisioning init failed (err %d)", err);
+		return err;
 	}
+
+	/* Configured as a node, configuring it again adds the sightings group */
+	if (self) {
+		atomic_clear_bit(self->flags, BT_MESH_CDB_NODE_CONFIGURED);
+	}
+
+	paused = false;
+
+	return provisioning_run();
+}
+
+int provisioning_pause(void)
+{
+	if (prov_state == PROV_STATE_BEACON_SEEN || prov_state == PROV_STATE_LINK_OPEN ||
+	    prov_state == PROV_STATE_NODE_ADDED) {
+		return -EBUSY;
+	}
+
+	paused = true;
+	k_work_cancel_delayable(&provisioning_timeout);
+
 	return 0;
+}
+
+void provisioning_resume(void)
+{
+	paused = false;
+	/* The timeout was cancelled, the idle state picks up from here */
+	atomic_set_bit(prov_events, PROV_EVT_TIMEOUT);
+	k_work_submit(&provisioning_work);
 }
\ No newline at end of file
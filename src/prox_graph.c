@@ -0,0 +1,477 @@
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/bluetooth/mesh.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(prox_graph, LOG_LEVEL_DBG);
+
+#include "fake_kconfig.h"
+
+#include "hw_id_index.h"
+#include "prox_graph.h"
+#include "peer_query.h"
+#include "role.h"
+#include "sighting_pub.h"
+
+BUILD_ASSERT(IS_POWER_OF_TWO(CONFIG_BL_PROX_VERTEX_TABLE_SIZE),
+	     "Vertex table size must be a power of two");
+BUILD_ASSERT(CONFIG_BL_PROX_VERTICES <= CONFIG_BL_PROX_VERTEX_TABLE_SIZE * 3 / 4,
+	     "Vertex count must stay below 3/4 of the table size");
+BUILD_ASSERT(CONFIG_BL_PROX_VERTICES < UINT16_MAX && CONFIG_BL_PROX_EDGES < UINT16_MAX,
+	     "Vertices and edges are indexed with 16 bits");
+
+#define NONE            UINT16_MAX
+
+/* Exponential moving average with alpha = 1 / 2^RSSI_EMA_SHIFT */
+#define RSSI_EMA_SHIFT  CONFIG_BL_PROX_RSSI_EMA_SHIFT
+
+/* Hash index of vertices by hw_id, see hw_id_index.h.
+ * Vertex and edge indices are stable, free ones are chained through
+ * vertex_head and edge_next[][0]. A vertex lives as long as it has edges.
+ *
+ * Every edge is on the adjacency lists of both its ends, edge_next[e][k]
+ * links the list of edge_ends[e][k]. The neighbours of a vertex are a walk
+ * of its list, O(degree), and an edge aging out is unlinked in place.
+ */
+static uint16_t vtable[CONFIG_BL_PROX_VERTEX_TABLE_SIZE];
+
+static uint64_t vertex_ids[CONFIG_BL_PROX_VERTICES];
+static uint16_t vertex_addrs[CONFIG_BL_PROX_VERTICES];
+static uint16_t vertex_head[CONFIG_BL_PROX_VERTICES];
+static uint16_t vertex_free;
+static uint16_t vertex_count;
+
+static uint16_t edge_ends[CONFIG_BL_PROX_EDGES][2];
+static uint16_t edge_next[CONFIG_BL_PROX_EDGES][2];
+static int16_t edge_rssi_q8[CONFIG_BL_PROX_EDGES];
+static uint32_t edge_seen_ms[CONFIG_BL_PROX_EDGES];
+static uint16_t edge_free;
+static uint16_t edge_count;
+
+/* Next edge for the aging sweep */
+static uint16_t aging_cursor;
+
+static uint32_t aged_out;
+static uint32_t dropped;
+
+static const struct hw_id_index vertex_index = HW_ID_INDEX_INIT(vtable, vertex_ids);
+
+static struct k_spinlock graph_lock;
+
+static void aging_work_handle(struct k_work *item);
+static K_WORK_DELAYABLE_DEFINE(aging_work, aging_work_handle);
+
+static inline uint16_t vertex_lookup(uint64_t hw_id)
+{
+	return hw_id_index_get(&vertex_index, hw_id_index_find(&vertex_index, hw_id));
+}
+
+static uint16_t vertex_get(uint64_t hw_id)
+{
+	uint32_t slot = hw_id_index_find(&vertex_index, hw_id);
+	uint16_t v = hw_id_index_get(&vertex_index, slot);
+
+	if (v != NONE || vertex_free == NONE) {
+		return v;
+	}
+
+	v = vertex_free;
+	vertex_free = vertex_head[v];
+
+	vertex_ids[v] = hw_id;
+	vertex_addrs[v] = BT_MESH_ADDR_UNASSIGNED;
+	vertex_head[v] = NONE;
+	hw_id_index_set(&vertex_index, slot, v);
+	vertex_count++;
+
+	return v;
+}
+
+/* Frees v once its last edge is gone */
+static void vertex_put(uint16_t v)
+{
+	if (vertex_head[v] != NONE) {
+		return;
+	}
+
+	hw_id_index_remove(&vertex_index, hw_id_index_find(&vertex_index, vertex_ids[v]));
+	vertex_head[v] = vertex_free;
+	vertex_free = v;
+	vertex_count--;
+}
+
+/* Which end of e is v */
+static inline int edge_end(uint16_t e, uint16_t v)
+{
+	return edge_ends[e][0] == v ? 0 : 1;
+}
+
+static inline bool edge_expired(uint16_t e, uint32_t now)
+{
+	return (int32_t)(now - edge_seen_ms[e]) >= CONFIG_BL_PROX_EDGE_TIMEOUT_MS;
+}
+
+static uint16_t edge_find(uint16_t a, uint16_t b)
+{
+	for (uint16_t e = vertex_head[a]; e != NONE; e = edge_next[e][edge_end(e, a)]) {
+		if (edge_ends[e][!edge_end(e, a)] == b) {
+			return e;
+		}
+	}
+
+	return NONE;
+}
+
+static uint16_t edge_add(uint16_t a, uint16_t b)
+{
+	uint16_t e = edge_free;
+
+	if (e == NONE) {
+		return NONE;
+	}
+
+	edge_free = edge_next[e][0];
+
+	edge_ends[e][0] = a;
+	edge_ends[e][1] = b;
+	edge_next[e][0] = vertex_head[a];
+	edge_next[e][1] = vertex_head[b];
+	vertex_head[a] = e;
+	vertex_head[b] = e;
+	edge_count++;
+
+	return e;
+}
+
+static void edge_unlink(uint16_t e, int k)
+{
+	uint16_t v = edge_ends[e][k];
+	uint16_t *link = &vertex_head[v];
+
+	while (*link != e) {
+		link = &edge_next[*link][edge_end(*link, v)];
+	}
+
+	*link = edge_next[e][k];
+}
+
+static void edge_remove(uint16_t e)
+{
+	uint16_t a = edge_ends[e][0];
+	uint16_t b = edge_ends[e][1];
+
+	edge_unlink(e, 0);
+	edge_unlink(e, 1);
+
+	edge_ends[e][0] = NONE;
+	edge_next[e][0] = edge_free;
+	edge_free = e;
+	edge_count--;
+
+	vertex_put(a);
+	vertex_put(b);
+}
+
+static void neighbour_copy(uint16_t e, uint16_t v, uint32_t now, struct prox_neighbour *out)
+{
+	uint16_t other = edge_ends[e][!edge_end(e, v)];
+
+	out->hw_id = vertex_ids[other];
+	out->addr = vertex_addrs[other];
+	out->rssi = (int8_t)(edge_rssi_q8[e] >> 8);
+	out->age_ms = now - edge_seen_ms[e];
+}
+
+/* The UUID starts with the hardware id, see hw_config.c */
+static bool reporter_resolve(uint16_t addr, uint64_t *hw_id)
+{
+	struct bt_mesh_cdb_node *node = bt_mesh_cdb_node_get(addr);
+
+	if (!node) {
+		return false;
+	}
+
+	memcpy(hw_id, node->uuid, sizeof(*hw_id));
+
+	return true;
+}
+
+static int graph_update(uint64_t reporter, uint16_t addr, uint64_t hw_id, int8_t rssi,
+			uint32_t age_ms)
+{
+	int16_t rssi_q8 = (int16_t)rssi * 256;
+	uint32_t seen = k_uptime_get_32() - age_ms;
+	uint16_t a;
+	uint16_t b = NONE;
+	uint16_t e = NONE;
+
+	if (reporter == hw_id) {
+		return -EINVAL;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&graph_lock);
+
+	a = vertex_get(reporter);
+	if (a != NONE) {
+		b = vertex_get(hw_id);
+	}
+
+	if (b != NONE) {
+		e = edge_find(a, b);
+		if (e != NONE) {
+			/* Arithmetic shift keeps the sign, both terms fit in int16_t */
+			edge_rssi_q8[e] += (rssi_q8 - edge_rssi_q8[e]) >> RSSI_EMA_SHIFT;
+			/* Reports of both ends may come in out of order */
+			if ((int32_t)(seen - edge_seen_ms[e]) > 0) {
+				edge_seen_ms[e] = seen;
+			}
+		} else {
+			e = edge_add(a, b);
+			if (e != NONE) {
+				edge_rssi_q8[e] = rssi_q8;
+				edge_seen_ms[e] = seen;
+			}
+		}
+	}
+
+	if (e == NONE) {
+		/* Drops the vertices just made for this report */
+		if (a != NONE) {
+			vertex_put(a);
+		}
+		if (b != NONE) {
+			vertex_put(b);
+		}
+		dropped++;
+		k_spin_unlock(&graph_lock, key);
+		return -ENOMEM;
+	}
+
+	vertex_addrs[a] = addr;
+
+	k_spin_unlock(&graph_lock, key);
+
+	return 0;
+}
+
+int prox_graph_update(uint16_t addr, uint64_t hw_id, int8_t rssi, uint32_t age_ms)
+{
+	uint64_t reporter;
+
+	if (!reporter_resolve(addr, &reporter)) {
+		return -ENOENT;
+	}
+
+	return graph_update(reporter, addr, hw_id, rssi, age_ms);
+}
+
+void prox_graph_remove(uint16_t addr, uint64_t hw_id)
+{
+	uint64_t reporter;
+
+	if (!reporter_resolve(addr, &reporter)) {
+		return;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&graph_lock);
+
+	uint16_t a = vertex_lookup(reporter);
+	uint16_t b = vertex_lookup(hw_id);
+
+	if (a != NONE && b != NONE) {
+		uint16_t e = edge_find(a, b);
+
+		if (e != NONE) {
+			edge_remove(e);
+		}
+	}
+
+	k_spin_unlock(&graph_lock, key);
+}
+
+size_t prox_graph_neighbours(uint64_t hw_id, struct prox_neighbour *out, size_t n)
+{
+	uint32_t now = k_uptime_get_32();
+	size_t count = 0;
+
+	k_spinlock_key_t key = k_spin_lock(&graph_lock);
+
+	uint16_t v = vertex_lookup(hw_id);
+
+	if (v != NONE) {
+		for (uint16_t e = vertex_head[v]; e != NONE && count < n;
+		     e = edge_next[e][edge_end(e, v)]) {
+			/* Not swept yet */
+			if (!edge_expired(e, now)) {
+				neighbour_copy(e, v, now, &out[count++]);
+			}
+		}
+	}
+
+	k_spin_unlock(&graph_lock, key);
+
+	return count;
+}
+
+size_t prox_graph_nearest(uint64_t hw_id, struct prox_neighbour *out, size_t n)
+{
+	uint16_t best[CONFIG_BL_PROX_NEAREST_MAX];
+	uint32_t now = k_uptime_get_32();
+	size_t count = 0;
+
+	n = MIN(n, ARRAY_SIZE(best));
+	if (n == 0) {
+		return 0;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&graph_lock);
+
+	uint16_t v = vertex_lookup(hw_id);
+
+	if (v == NONE) {
+		k_spin_unlock(&graph_lock, key);
+		return 0;
+	}
+
+	/* Insertion into the strongest n so far, the degree is small */
+	for (uint16_t e = vertex_head[v]; e != NONE; e = edge_next[e][edge_end(e, v)]) {
+		if (edge_expired(e, now)) {
+			continue;
+		}
+
+		size_t i = count < n ? count++ : n;
+
+		while (i > 0 && edge_rssi_q8[best[i - 1]] < edge_rssi_q8[e]) {
+			if (i < n) {
+				best[i] = best[i - 1];
+			}
+			i--;
+		}
+
+		if (i < n) {
+			best[i] = e;
+		}
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		neighbour_copy(best[i], v, now, &out[i]);
+	}
+
+	k_spin_unlock(&graph_lock, key);
+
+	return count;
+}
+
+void prox_graph_stats_get(struct prox_graph_stats *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&graph_lock);
+
+	out->vertices = vertex_count;
+	out->edges = edge_count;
+	out->aged_out = aged_out;
+	out->dropped = dropped;
+
+	k_spin_unlock(&graph_lock, key);
+}
+
+/* Visits a bounded number of edges per period, a full sweep takes
+ * CONFIG_BL_PROX_EDGES / CONFIG_BL_PROX_AGING_STEP periods. Queries skip
+ * expired edges the sweep has not reached yet.
+ */
+static void aging_work_handle(struct k_work *item)
+{
+	uint32_t now = k_uptime_get_32();
+	size_t removed = 0;
+
+	k_spinlock_key_t key = k_spin_lock(&graph_lock);
+
+	for (size_t i = 0; i < MIN(CONFIG_BL_PROX_AGING_STEP, CONFIG_BL_PROX_EDGES); i++) {
+		uint16_t e = aging_cursor;
+
+		aging_cursor = (aging_cursor + 1) % CONFIG_BL_PROX_EDGES;
+
+		if (edge_ends[e][0] != NONE && edge_expired(e, now)) {
+			edge_remove(e);
+			removed++;
+		}
+	}
+
+	aged_out += removed;
+
+	k_spin_unlock(&graph_lock, key);
+
+	if (removed) {
+		LOG_DBG("Aged out %zu edges", removed);
+	}
+
+	k_work_reschedule(&aging_work, K_MSEC(CONFIG_BL_PROX_AGING_MS));
+}
+
+static void sightings_recv(uint16_t src, const struct sighting_report *reports, size_t count)
+{
+	uint64_t reporter;
+
+	if (!role_is_provisioner() || !reporter_resolve(src, &reporter)) {
+		return;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		(void)graph_update(reporter, src, reports[i].hw_id, reports[i].rssi,
+				   reports[i].age * 100);
+	}
+}
+
+static void peer_query_changed(uint16_t addr, const struct peer_query_change *change)
+{
+	if (!role_is_provisioner()) {
+		return;
+	}
+
+	/* A reset resends the whole table, edges it no longer has age out */
+	switch (change->kind) {
+	case PEER_QUERY_ADDED:
+	case PEER_QUERY_CHANGED:
+		(void)prox_graph_update(addr, change->hw_id, change->rssi, 0);
+		break;
+	case PEER_QUERY_REMOVED:
+		prox_graph_remove(addr, change->hw_id);
+		break;
+	default:
+		break;
+	}
+}
+
+int prox_graph_start(void)
+{
+	if (!IS_ENABLED(CONFIG_BL_PROVISIONER)) {
+		return 0;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&graph_lock);
+
+	hw_id_index_clear(&vertex_index);
+
+	for (uint16_t v = 0; v < CONFIG_BL_PROX_VERTICES; v++) {
+		vertex_head[v] = v + 1 < CONFIG_BL_PROX_VERTICES ? v + 1 : NONE;
+	}
+	vertex_free = 0;
+	vertex_count = 0;
+
+	for (uint16_t e = 0; e < CONFIG_BL_PROX_EDGES; e++) {
+		edge_ends[e][0] = NONE;
+		edge_next[e][0] = e + 1 < CONFIG_BL_PROX_EDGES ? e + 1 : NONE;
+	}
+	edge_free = 0;
+	edge_count = 0;
+
+	k_spin_unlock(&graph_lock, key);
+
+	sighting_pub_recv_set(sightings_recv);
+	peer_query_cb_set(peer_query_changed);
+
+	k_work_reschedule(&aging_work, K_MSEC(CONFIG_BL_PROX_AGING_MS));
+
+	return 0;
+}
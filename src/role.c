@@ -0,0 +1,767 @@
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/mesh.h>
+#include <zephyr/settings/settings.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(role, LOG_LEVEL_DBG);
+
+#include "fake_kconfig.h"
+
+#include "role.h"
+#include "mesh_vnd.h"
+#include "hw_config.h"
+#include "node.h"
+#include "node_config.h"
+#include "peer_table.h"
+#include "peer_query.h"
+#include "provisioning.h"
+#include "sighting_pub.h"
+
+#define ROLE_KEY "bl/role/cur"
+
+/* The only subnet and app key, as set up by provisioning.c */
+#define HANDOVER_NET_IDX BT_MESH_NET_PRIMARY
+#define HANDOVER_APP_IDX 0
+
+#define HANDOVER_NODE_CONFIGURED BIT(0)
+
+#define HANDOVER_ACK_OK     0
+#define HANDOVER_ACK_FAILED 1
+
+/* net key, app key, IV index, node count */
+#define HANDOVER_START_LEN  (16 + 16 + 4 + 2)
+/* seq, address, element count, flags, UUID, device key */
+#define HANDOVER_NODE_LEN   (2 + 2 + 1 + 1 + 16 + 16)
+/* node count */
+#define HANDOVER_COMMIT_LEN 2
+/* seq, status */
+#define HANDOVER_ACK_LEN    3
+
+static atomic_t provisioner;
+static bool role_stored;
+
+/* Sending side, runs on the system work queue like the provisioning state
+ * machine. Stop and wait: seq 0 is the start, 1 to count the nodes and
+ * count + 1 the commit.
+ */
+struct handover_tx {
+	uint16_t dst;
+	uint16_t addrs[CONFIG_BT_MESH_CDB_NODE_COUNT];
+	uint16_t count;
+	uint16_t seq;
+	uint8_t retries;
+	uint8_t status;
+	bool active;
+	bool prepared;
+	bool acked;
+};
+
+/* Receiving side, fed from the mesh RX thread */
+struct handover_rx {
+	uint16_t src;
+	uint16_t count;
+	uint16_t next;
+	bool active;
+	bool committed;
+};
+
+static struct handover_tx tx;
+static struct k_spinlock tx_lock;
+static struct handover_rx rx;
+static K_MUTEX_DEFINE(rx_lock);
+
+static void tx_work_handle(struct k_work *item);
+static K_WORK_DELAYABLE_DEFINE(tx_work, tx_work_handle);
+static void rx_abort_handle(struct k_work *item);
+static K_WORK_DELAYABLE_DEFINE(rx_abort_work, rx_abort_handle);
+static void promote_handle(struct k_work *item);
+static K_WORK_DEFINE(promote_work, promote_handle);
+
+/* Provisioning callbacks, forwarded to the current role */
+static const struct bt_mesh_prov *role_prov(void)
+{
+	return atomic_get(&provisioner) ? &provisioner_prov : &node_prov;
+}
+
+static void prov_link_open(enum bt_mesh_prov_bearer bearer)
+{
+	if (role_prov()->link_open) {
+		role_prov()->link_open(bearer);
+	}
+}
+
+static void prov_link_close(enum bt_mesh_prov_bearer bearer)
+{
+	if (role_prov()->link_close) {
+		role_prov()->link_close(bearer);
+	}
+}
+
+static void prov_complete(uint16_t net_idx, uint16_t addr)
+{
+	if (role_prov()->complete) {
+		role_prov()->complete(net_idx, addr);
+	}
+}
+
+static void prov_reset(void)
+{
+	if (role_prov()->reset) {
+		role_prov()->reset();
+	}
+}
+
+static void prov_unprovisioned_beacon(uint8_t uuid[16], bt_mesh_prov_oob_info_t oob_info,
+				      uint32_t *uri_hash)
+{
+	if (role_prov()->unprovisioned_beacon) {
+		role_prov()->unprovisioned_beacon(uuid, oob_info, uri_hash);
+	}
+}
+
+static void prov_node_added(uint16_t net_idx, uint8_t uuid[16], uint16_t addr, uint8_t num_elem)
+{
+	if (role_prov()->node_added) {
+		role_prov()->node_added(net_idx, uuid, addr, num_elem);
+	}
+}
+
+const struct bt_mesh_prov mesh_prov = {
+	.uuid = dev_uuid,
+	.link_open = prov_link_open,
+	.link_close = prov_link_close,
+	.complete = prov_complete,
+	.reset = prov_reset,
+	.unprovisioned_beacon = prov_unprovisioned_beacon,
+	.node_added = prov_node_added,
+};
+
+/* Models */
+static int handover_start(const struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx,
+			  struct net_buf_simple *buf);
+static int handover_node(const struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx,
+			 struct net_buf_simple *buf);
+static int handover_commit(const struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx,
+			   struct net_buf_simple *buf);
+static int handover_ack(const struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx,
+			struct net_buf_simple *buf);
+
+static int handover_init(const struct bt_mesh_model *model)
+{
+	/* Device key only, like the configuration models. This also takes
+	 * the only key slot, so no app key can be bound.
+	 */
+	model->keys[0] = BT_MESH_KEY_DEV_ANY;
+
+	return 0;
+}
+
+static const struct bt_mesh_model_op handover_ops[] = {
+	{ VND_OP_HANDOVER_START, BT_MESH_LEN_EXACT(HANDOVER_START_LEN), handover_start },
+	{ VND_OP_HANDOVER_NODE, BT_MESH_LEN_EXACT(HANDOVER_NODE_LEN), handover_node },
+	{ VND_OP_HANDOVER_COMMIT, BT_MESH_LEN_EXACT(HANDOVER_COMMIT_LEN), handover_commit },
+	{ VND_OP_HANDOVER_ACK, BT_MESH_LEN_EXACT(HANDOVER_ACK_LEN), handover_ack },
+	BT_MESH_MODEL_OP_END,
+};
+
+static const struct bt_mesh_model_cb handover_cb = {
+	.init = handover_init,
+};
+
+static struct bt_mesh_cfg_cli cfg_cli = {
+	.cb = &node_config_cli_cb,
+};
+
+static const struct bt_mesh_model sig_models[] = {
+	BT_MESH_MODEL_CFG_SRV,
+	BT_MESH_MODEL_CFG_CLI(&cfg_cli),
+};
+
+static const struct bt_mesh_model vnd_models[] = {
+	BT_MESH_MODEL_VND_CB(CONFIG_BL_COMPOSITION_COMPANY_ID, VND_MODEL_ID_HANDOVER,
+			     handover_ops, NULL, NULL, &handover_cb),
+	BT_MESH_MODEL_VND_CB(CONFIG_BL_COMPOSITION_COMPANY_ID, VND_MODEL_ID_SIGHTINGS,
+			     sighting_pub_ops, NULL, NULL, &sighting_pub_cb),
+	BT_MESH_MODEL_VND_CB(CONFIG_BL_COMPOSITION_COMPANY_ID, VND_MODEL_ID_PEER_QUERY_SRV,
+			     peer_query_srv_ops, NULL, NULL, &peer_query_srv_cb),
+	BT_MESH_MODEL_VND_CB(CONFIG_BL_COMPOSITION_COMPANY_ID, VND_MODEL_ID_PEER_QUERY_CLI,
+			     peer_query_cli_ops, NULL, NULL, &peer_query_cli_cb),
+};
+
+static const struct bt_mesh_elem elements[] = {
+	BT_MESH_ELEM(0, sig_models, vnd_models),
+};
+
+const struct bt_mesh_comp mesh_comp = {
+	.cid = CONFIG_BL_COMPOSITION_COMPANY_ID,
+	.pid = CONFIG_BL_COMPOSITION_PRODUCT_ID,
+	.vid = CONFIG_BL_COMPOSITION_VERSION_ID,
+	.elem = elements,
+	.elem_count = ARRAY_SIZE(elements),
+};
+
+#define handover_model (&vnd_models[0])
+
+/* Role */
+static void role_set(bool is_provisioner)
+{
+	atomic_set(&provisioner, is_provisioner);
+
+	if (IS_ENABLED(CONFIG_SETTINGS)) {
+		uint8_t val = is_provisioner;
+		int err = settings_save_one(ROLE_KEY, &val, sizeof(val));
+
+		if (err) {
+			LOG_ERR("Failed to store role (err %d)", err);
+		}
+	}
+}
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+static int role_settings_set(const char *key, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+	uint8_t val;
+	ssize_t read;
+
+	if (strcmp(key, "cur")) {
+		return -ENOENT;
+	}
+
+	if (len != sizeof(val)) {
+		return -EINVAL;
+	}
+
+	read = read_cb(cb_arg, &val, sizeof(val));
+	if (read < 0) {
+		return read;
+	}
+
+	atomic_set(&provisioner, val != 0 && IS_ENABLED(CONFIG_BL_PROVISIONER));
+	role_stored = true;
+
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(bl_role, "bl/role", NULL, role_settings_set, NULL, NULL);
+#endif
+
+int role_init(bool is_provisioner)
+{
+	if (is_provisioner && !IS_ENABLED(CONFIG_BL_PROVISIONER)) {
+		LOG_WRN("Built without provisioner support, starting as node");
+		is_provisioner = false;
+	}
+
+	atomic_set(&provisioner, is_provisioner);
+
+	return 0;
+}
+
+bool role_is_provisioner(void)
+{
+	return atomic_get(&provisioner);
+}
+
+int role_start(void)
+{
+	if (role_stored) {
+		LOG_INF("Using stored role");
+	}
+
+	if (role_is_provisioner()) {
+		LOG_INF("Starting as provisioner");
+		return provisioning_start();
+	}
+
+	LOG_INF("Starting as regular node");
+	return node_start();
+}
+
+/* Sending side */
+static uint8_t tx_collect(struct bt_mesh_cdb_node *node, void *data)
+{
+	if (tx.count < ARRAY_SIZE(tx.addrs)) {
+		tx.addrs[tx.count++] = node->addr;
+	}
+
+	return BT_MESH_CDB_ITER_CONTINUE;
+}
+
+static int tx_send_start(struct net_buf_simple *msg)
+{
+	struct bt_mesh_cdb_subnet *subnet = bt_mesh_cdb_subnet_get(HANDOVER_NET_IDX);
+	struct bt_mesh_cdb_app_key *app_key = bt_mesh_cdb_app_key_get(HANDOVER_APP_IDX);
+	uint8_t key[16];
+	int err;
+
+	if (!subnet || !app_key) {
+		return -ENOENT;
+	}
+
+	bt_mesh_model_msg_init(msg, VND_OP_HANDOVER_START);
+
+	err = bt_mesh_cdb_subnet_key_export(subnet, 0, key);
+	if (err) {
+		return err;
+	}
+	net_buf_simple_add_mem(msg, key, sizeof(key));
+
+	err = bt_mesh_cdb_app_key_export(app_key, 0, key);
+	if (err) {
+		return err;
+	}
+	net_buf_simple_add_mem(msg, key, sizeof(key));
+	memset(key, 0, sizeof(key));
+
+	net_buf_simple_add_le32(msg, bt_mesh_cdb.iv_index);
+	net_buf_simple_add_le16(msg, tx.count);
+
+	return 0;
+}
+
+static int tx_send_node(struct net_buf_simple *msg)
+{
+	struct bt_mesh_cdb_node *node = bt_mesh_cdb_node_get(tx.addrs[tx.seq - 1]);
+	uint8_t dev_key[16];
+	int err;
+
+	/* Provisioning is paused, only a node reset can remove it */
+	if (!node) {
+		return -ENOENT;
+	}
+
+	err = bt_mesh_cdb_node_key_export(node, dev_key);
+	if (err) {
+		return err;
+	}
+
+	bt_mesh_model_msg_init(msg, VND_OP_HANDOVER_NODE);
+	net_buf_simple_add_le16(msg, tx.seq);
+	net_buf_simple_add_le16(msg, node->addr);
+	net_buf_simple_add_u8(msg, node->num_elem);
+	net_buf_simple_add_u8(msg, atomic_test_bit(node->flags, BT_MESH_CDB_NODE_CONFIGURED) ?
+				   HANDOVER_NODE_CONFIGURED : 0);
+	net_buf_simple_add_mem(msg, node->uuid, 16);
+	net_buf_simple_add_mem(msg, dev_key, sizeof(dev_key));
+	memset(dev_key, 0, sizeof(dev_key));
+
+	return 0;
+}
+
+static int tx_send(void)
+{
+	BT_MESH_MODEL_BUF_DEFINE(msg, VND_OP_HANDOVER_NODE,
+				 MAX(HANDOVER_START_LEN, HANDOVER_NODE_LEN));
+	struct bt_mesh_msg_ctx ctx = BT_MESH_MSG_CTX_INIT_DEV(HANDOVER_NET_IDX, tx.dst);
+	int err = 0;
+
+	if (tx.seq == 0) {
+		err = tx_send_start(&msg);
+	} else if (tx.seq <= tx.count) {
+		err = tx_send_node(&msg);
+	} else {
+		bt_mesh_model_msg_init(&msg, VND_OP_HANDOVER_COMMIT);
+		net_buf_simple_add_le16(&msg, tx.count);
+	}
+
+	if (err) {
+		return err;
+	}
+
+	return bt_mesh_model_send(handover_model, &ctx, &msg, NULL, NULL);
+}
+
+static void tx_finish(int err)
+{
+	if (err) {
+		LOG_ERR("Handover to 0x%04x failed (err %d)", tx.dst, err);
+		provisioning_resume();
+	} else {
+		LOG_INF("Handed %u nodes over to 0x%04x, continuing as node", tx.count, tx.dst);
+		(void)node_config_sightings_leave();
+		bt_mesh_cdb_clear();
+		role_set(false);
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&tx_lock);
+
+	tx.active = false;
+	tx.prepared = false;
+
+	k_spin_unlock(&tx_lock, key);
+}
+
+static void tx_work_handle(struct k_work *item)
+{
+	k_spinlock_key_t key = k_spin_lock(&tx_lock);
+	bool acked = tx.acked;
+	uint8_t status = tx.status;
+
+	tx.acked = false;
+	k_spin_unlock(&tx_lock, key);
+
+	if (!tx.prepared) {
+		/* Keeps the CDB unchanged while it is sent */
+		if (provisioning_pause() == -EBUSY) {
+			k_work_reschedule(&tx_work, K_MSEC(CONFIG_BL_ROLE_HANDOVER_BUSY_RETRY_MS));
+			return;
+		}
+
+		tx.count = 0;
+		bt_mesh_cdb_node_foreach(tx_collect, NULL);
+		tx.retries = CONFIG_BL_ROLE_HANDOVER_RETRIES;
+		tx.prepared = true;
+		LOG_INF("Handing %u nodes over to 0x%04x", tx.count, tx.dst);
+	} else if (acked) {
+		if (status != HANDOVER_ACK_OK) {
+			tx_finish(-EIO);
+			return;
+		}
+
+		if (tx.seq == tx.count + 1) {
+			tx_finish(0);
+			return;
+		}
+
+		key = k_spin_lock(&tx_lock);
+		tx.seq++;
+		k_spin_unlock(&tx_lock, key);
+		tx.retries = CONFIG_BL_ROLE_HANDOVER_RETRIES;
+	} else if (tx.retries-- == 0) {
+		tx_finish(-ETIMEDOUT);
+		return;
+	}
+
+	int err = tx_send();
+
+	if (err == -ENOENT || err == -EINVAL) {
+		tx_finish(err);
+		return;
+	}
+	if (err) {
+		/* Resent on timeout */
+		LOG_WRN("Handover message %u not sent (err %d)", tx.seq, err);
+	}
+
+	k_work_reschedule(&tx_work, K_MSEC(CONFIG_BL_ROLE_HANDOVER_TIMEOUT_MS));
+}
+
+int role_handover(uint16_t addr)
+{
+	if (!role_is_provisioner()) {
+		return -EPERM;
+	}
+
+	if (addr == bt_mesh_primary_addr() || !bt_mesh_cdb_node_get(addr)) {
+		return -EINVAL;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&tx_lock);
+
+	if (tx.active) {
+		k_spin_unlock(&tx_lock, key);
+		return -EBUSY;
+	}
+
+	tx.active = true;
+	tx.prepared = false;
+	tx.acked = false;
+	tx.dst = addr;
+	tx.seq = 0;
+
+	k_spin_unlock(&tx_lock, key);
+
+	k_work_reschedule(&tx_work, K_NO_WAIT);
+
+	return 0;
+}
+
+struct hw_id_match {
+	uint64_t hw_id;
+	uint16_t addr;
+};
+
+static uint8_t match_hw_id(struct bt_mesh_cdb_node *node, void *data)
+{
+	struct hw_id_match *match = data;
+
+	/* The UUID starts with the hardware id, see hw_config.c */
+	if (atomic_test_bit(node->flags, BT_MESH_CDB_NODE_CONFIGURED) &&
+	    !memcmp(node->uuid, &match->hw_id, sizeof(match->hw_id))) {
+		match->addr = node->addr;
+		return BT_MESH_CDB_ITER_STOP;
+	}
+
+	return BT_MESH_CDB_ITER_CONTINUE;
+}
+
+int role_handover_nearest(void)
+{
+	struct peer_entry nearest[CONFIG_BL_PEER_NEAREST_MAX];
+	size_t count = peer_table_nearest(nearest, ARRAY_SIZE(nearest));
+
+	for (size_t i = 0; i < count; i++) {
+		struct hw_id_match match = { .hw_id = nearest[i].hw_id };
+
+		bt_mesh_cdb_node_foreach(match_hw_id, &match);
+		if (match.addr != BT_MESH_ADDR_UNASSIGNED) {
+			return role_handover(match.addr);
+		}
+	}
+
+	return -ENOENT;
+}
+
+static int handover_ack(const struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx,
+			struct net_buf_simple *buf)
+{
+	uint16_t seq = net_buf_simple_pull_le16(buf);
+	uint8_t status = net_buf_simple_pull_u8(buf);
+	bool match;
+
+	if (!BT_MESH_IS_DEV_KEY(ctx->app_idx)) {
+		return -EPERM;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&tx_lock);
+
+	match = tx.active && tx.prepared && ctx->addr == tx.dst && seq == tx.seq;
+	if (match) {
+		tx.acked = true;
+		tx.status = status;
+	}
+
+	k_spin_unlock(&tx_lock, key);
+
+	if (match) {
+		k_work_reschedule(&tx_work, K_NO_WAIT);
+	}
+
+	return 0;
+}
+
+/* Receiving side */
+static void ack_send(struct bt_mesh_msg_ctx *ctx, uint16_t seq, uint8_t status)
+{
+	BT_MESH_MODEL_BUF_DEFINE(msg, VND_OP_HANDOVER_ACK, HANDOVER_ACK_LEN);
+
+	bt_mesh_model_msg_init(&msg, VND_OP_HANDOVER_ACK);
+	net_buf_simple_add_le16(&msg, seq);
+	net_buf_simple_add_u8(&msg, status);
+
+	/* Replies with our own device key, the provisioner has it in its CDB */
+	(void)bt_mesh_model_send(handover_model, ctx, &msg, NULL, NULL);
+}
+
+static int rx_import_start(const uint8_t *net_key, const uint8_t *app_key, uint32_t iv_index)
+{
+	struct bt_mesh_cdb_app_key *key;
+	int err;
+
+	/* Whatever an earlier attempt left behind */
+	bt_mesh_cdb_clear();
+
+	err = bt_mesh_cdb_create(net_key);
+	if (err) {
+		return err;
+	}
+
+	bt_mesh_cdb_iv_update(iv_index, false);
+
+	key = bt_mesh_cdb_app_key_alloc(HANDOVER_NET_IDX, HANDOVER_APP_IDX);
+	if (!key) {
+		return -ENOMEM;
+	}
+
+	err = bt_mesh_cdb_app_key_import(key, 0, app_key);
+	if (err) {
+		return err;
+	}
+
+	if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
+		bt_mesh_cdb_app_key_store(key);
+	}
+
+	return 0;
+}
+
+static int handover_start(const struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx,
+			  struct net_buf_simple *buf)
+{
+	const uint8_t *net_key = net_buf_simple_pull_mem(buf, 16);
+	const uint8_t *app_key = net_buf_simple_pull_mem(buf, 16);
+	uint32_t iv_index = net_buf_simple_pull_le32(buf);
+	uint16_t count = net_buf_simple_pull_le16(buf);
+	uint8_t status = HANDOVER_ACK_OK;
+	int err;
+
+	if (!BT_MESH_IS_DEV_KEY(ctx->app_idx) || role_is_provisioner()) {
+		return -EPERM;
+	}
+
+	if (!IS_ENABLED(CONFIG_BL_PROVISIONER)) {
+		LOG_WRN("Refusing handover from 0x%04x, built as node only", ctx->addr);
+		ack_send(ctx, 0, HANDOVER_ACK_FAILED);
+		return 0;
+	}
+
+	k_mutex_lock(&rx_lock, K_FOREVER);
+
+	err = rx_import_start(net_key, app_key, iv_index);
+	if (err) {
+		LOG_ERR("Failed to start CDB import (err %d)", err);
+		bt_mesh_cdb_clear();
+		status = HANDOVER_ACK_FAILED;
+	} else {
+		LOG_INF("Importing %u nodes from 0x%04x", count, ctx->addr);
+		k_work_reschedule(&rx_abort_work, K_MSEC(CONFIG_BL_ROLE_HANDOVER_IDLE_MS));
+	}
+
+	rx = (struct handover_rx) {
+		.src = ctx->addr,
+		.count = count,
+		.next = 1,
+		.active = !err,
+	};
+
+	k_mutex_unlock(&rx_lock);
+
+	ack_send(ctx, 0, status);
+
+	return 0;
+}
+
+static int rx_import_node(uint16_t addr, uint8_t num_elem, uint8_t flags, const uint8_t *uuid,
+			  const uint8_t *dev_key)
+{
+	struct bt_mesh_cdb_node *node;
+	int err;
+
+	node = bt_mesh_cdb_node_alloc(uuid, addr, num_elem, HANDOVER_NET_IDX);
+	if (!node) {
+		return -ENOMEM;
+	}
+
+	err = bt_mesh_cdb_node_key_import(node, dev_key);
+	if (err) {
+		bt_mesh_cdb_node_del(node, false);
+		return err;
+	}
+
+	if (flags & HANDOVER_NODE_CONFIGURED) {
+		atomic_set_bit(node->flags, BT_MESH_CDB_NODE_CONFIGURED);
+	}
+
+	if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
+		bt_mesh_cdb_node_store(node);
+	}
+
+	return 0;
+}
+
+static int handover_node(const struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx,
+			 struct net_buf_simple *buf)
+{
+	uint16_t seq = net_buf_simple_pull_le16(buf);
+	uint16_t addr = net_buf_simple_pull_le16(buf);
+	uint8_t num_elem = net_buf_simple_pull_u8(buf);
+	uint8_t flags = net_buf_simple_pull_u8(buf);
+	const uint8_t *uuid = net_buf_simple_pull_mem(buf, 16);
+	const uint8_t *dev_key = net_buf_simple_pull_mem(buf, 16);
+	uint8_t status = HANDOVER_ACK_OK;
+
+	if (!BT_MESH_IS_DEV_KEY(ctx->app_idx)) {
+		return -EPERM;
+	}
+
+	k_mutex_lock(&rx_lock, K_FOREVER);
+
+	if (!rx.active || ctx->addr != rx.src) {
+		k_mutex_unlock(&rx_lock);
+		return -EINVAL;
+	}
+
+	/* Older seqs are retransmissions whose ack got lost */
+	if (seq == rx.next) {
+		int err = rx_import_node(addr, num_elem, flags, uuid, dev_key);
+
+		if (err) {
+			LOG_ERR("Failed to import node 0x%04x (err %d)", addr, err);
+			status = HANDOVER_ACK_FAILED;
+		} else {
+			rx.next++;
+		}
+		k_work_reschedule(&rx_abort_work, K_MSEC(CONFIG_BL_ROLE_HANDOVER_IDLE_MS));
+	} else if (seq > rx.next) {
+		status = HANDOVER_ACK_FAILED;
+	}
+
+	k_mutex_unlock(&rx_lock);
+
+	ack_send(ctx, seq, status);
+
+	return 0;
+}
+
+static int handover_commit(const struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx,
+			   struct net_buf_simple *buf)
+{
+	uint16_t count = net_buf_simple_pull_le16(buf);
+	uint8_t status = HANDOVER_ACK_FAILED;
+
+	if (!BT_MESH_IS_DEV_KEY(ctx->app_idx)) {
+		return -EPERM;
+	}
+
+	k_mutex_lock(&rx_lock, K_FOREVER);
+
+	if (ctx->addr != rx.src) {
+		k_mutex_unlock(&rx_lock);
+		return -EINVAL;
+	}
+
+	if (rx.committed) {
+		/* Our ack got lost, we already took over */
+		status = HANDOVER_ACK_OK;
+	} else if (rx.active && count == rx.count && rx.next == count + 1) {
+		rx.active = false;
+		rx.committed = true;
+		k_work_cancel_delayable(&rx_abort_work);
+		k_work_submit(&promote_work);
+		status = HANDOVER_ACK_OK;
+	}
+
+	k_mutex_unlock(&rx_lock);
+
+	ack_send(ctx, count + 1, status);
+
+	return 0;
+}
+
+static void rx_abort_handle(struct k_work *item)
+{
+	k_mutex_lock(&rx_lock, K_FOREVER);
+
+	if (rx.active) {
+		LOG_WRN("Handover from 0x%04x stalled, dropping %u imported nodes",
+			rx.src, rx.next - 1);
+		bt_mesh_cdb_clear();
+		rx.active = false;
+	}
+
+	k_mutex_unlock(&rx_lock);
+}
+
+static void promote_handle(struct k_work *item)
+{
+	LOG_INF("Promoted to provisioner");
+	role_set(true);
+
+	int err = provisioning_takeover();
+
+	if (err) {
+		LOG_ERR("Provisioning takeover failed (err %d)", err);
+	}
+}
@@ -0,0 +1,128 @@
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/gap.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(scan_dispatch, LOG_LEVEL_DBG);
+
+#include "scan_dispatch.h"
+
+static sys_slist_t consumers = SYS_SLIST_STATIC_INIT(&consumers);
+static uint32_t class_counts[SCAN_CLASS_COUNT];
+static bool started;
+
+static struct bt_le_scan_param scan_param = {
+	.type     = BT_LE_SCAN_TYPE_PASSIVE,
+	.interval = BT_GAP_SCAN_FAST_INTERVAL,
+	.window   = BT_GAP_SCAN_FAST_WINDOW,
+	.options  = BT_LE_SCAN_OPT_NONE,
+	.timeout  = 0,
+};
+
+/* Single pass over the AD chain, stops at the first AD type we route on */
+enum scan_class scan_classify(const struct net_buf_simple *buf, struct scan_report *report)
+{
+	const uint8_t *p = buf->data;
+	const uint8_t *end = buf->data + buf->len;
+
+	while (end - p >= 2) {
+		uint8_t ad_len = p[0];
+
+		/* Zero length marks early termination, overrun is malformed */
+		if (ad_len == 0 || ad_len > end - p - 1) {
+			break;
+		}
+
+		report->data = &p[2];
+		report->data_len = ad_len - 1;
+
+		switch (p[1]) {
+		case BT_DATA_MESH_MESSAGE:
+			return SCAN_CLASS_MESH_MSG;
+		case BT_DATA_MESH_BEACON:
+			return SCAN_CLASS_MESH_BEACON;
+		case BT_DATA_MESH_PROV:
+			return SCAN_CLASS_MESH_PROV;
+		case BT_DATA_MANUFACTURER_DATA:
+			return SCAN_CLASS_MFG;
+		default:
+			break;
+		}
+
+		p += ad_len + 1;
+	}
+
+	report->data = NULL;
+	report->data_len = 0;
+	return SCAN_CLASS_OTHER;
+}
+
+void scan_dispatch_recv(const struct bt_le_scan_recv_info *info, struct net_buf_simple *buf)
+{
+	struct scan_report report = { .info = info };
+	struct scan_consumer *consumer;
+	enum scan_class cls = scan_classify(buf, &report);
+
+	class_counts[cls]++;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&consumers, consumer, node) {
+		if (consumer->class_mask & BIT(cls)) {
+			consumer->recv(cls, &report);
+		}
+	}
+}
+
+static struct bt_le_scan_cb scan_listener = {
+	.recv = scan_dispatch_recv,
+};
+
+int scan_dispatch_register(struct scan_consumer *consumer)
+{
+	if (!consumer || !consumer->recv) {
+		return -EINVAL;
+	}
+
+	/* Consumers are registered during init, before reports are flowing */
+	sys_slist_append(&consumers, &consumer->node);
+	return 0;
+}
+
+int scan_dispatch_start(void)
+{
+	int err = 0;
+
+	if (started) {
+		return 0;
+	}
+
+	/* The listener sees every report, whoever started the scanner */
+	bt_le_scan_cb_register(&scan_listener);
+	started = true;
+
+	/* Mesh binds its receive path to the scanner it starts itself, starting
+	 * ours first would leave mesh without beacons. With mesh enabled we
+	 * only listen, the scanner comes up as soon as mesh is initialized.
+	 */
+	if (IS_ENABLED(CONFIG_BT_MESH)) {
+		LOG_DBG("Sharing the mesh scanner");
+		return 0;
+	}
+
+	err = bt_le_scan_start(&scan_param, NULL);
+	if (err == -EALREADY) {
+		err = 0;
+	}
+	if (err) {
+		LOG_ERR("Scanning failed to start (err %d)", err);
+		return err;
+	}
+
+	return 0;
+}
+
+void scan_dispatch_counts_get(uint32_t counts[SCAN_CLASS_COUNT])
+{
+	for (int i = 0; i < SCAN_CLASS_COUNT; i++) {
+		counts[i] = class_counts[i];
+	}
+}
@@ -0,0 +1,186 @@
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/bluetooth/mesh.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(scan_sched, LOG_LEVEL_DBG);
+
+#include "fake_kconfig.h"
+
+#include "peer.h"
+#include "scan_dispatch.h"
+#include "scan_sched.h"
+
+/* Mesh owns the scanner and keeps it running, the duty left to us is our
+ * own advertising. Units of 0.625 ms.
+ */
+static const struct {
+	uint16_t min;
+	uint16_t max;
+} mode_interval[SCAN_MODE_COUNT] = {
+	[SCAN_MODE_DISCOVERY] = {
+		CONFIG_BL_SCAN_SCHED_DISCOVERY_INT_MIN, CONFIG_BL_SCAN_SCHED_DISCOVERY_INT_MAX,
+	},
+	[SCAN_MODE_TRACKING] = {
+		CONFIG_BL_SCAN_SCHED_TRACKING_INT_MIN, CONFIG_BL_SCAN_SCHED_TRACKING_INT_MAX,
+	},
+	[SCAN_MODE_RELAXED] = {
+		CONFIG_BL_SCAN_SCHED_RELAXED_INT_MIN, CONFIG_BL_SCAN_SCHED_RELAXED_INT_MAX,
+	},
+};
+
+/* Peers must still hear us several times per peer timeout */
+BUILD_ASSERT(CONFIG_BL_SCAN_SCHED_RELAXED_INT_MAX * 5 / 8 * 4 <= CONFIG_BL_PEER_TIMEOUT_MS,
+	     "Relaxed advertising must fit four advertisements per peer timeout");
+
+static const char *const mode_name[SCAN_MODE_COUNT] = {
+	[SCAN_MODE_DISCOVERY] = "discovery",
+	[SCAN_MODE_TRACKING] = "tracking",
+	[SCAN_MODE_RELAXED] = "relaxed",
+};
+
+static void sched_work_handle(struct k_work *item);
+static K_WORK_DELAYABLE_DEFINE(sched_work, sched_work_handle);
+
+static bool started;
+static atomic_t kick_until_ms;
+static struct k_spinlock stats_lock;
+static struct scan_sched_stats stats = { .mode = SCAN_MODE_DISCOVERY };
+static uint32_t mode_since_ms;
+static uint32_t lower_since_ms;
+static uint32_t last_counts[SCAN_CLASS_COUNT];
+
+/* Only the scheduler work updates the counters, readers take the lock */
+static void stats_account(uint32_t now)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	stats.mode_ms[stats.mode] += now - mode_since_ms;
+	mode_since_ms = now;
+
+	k_spin_unlock(&stats_lock, key);
+}
+
+static enum scan_mode sched_demand(uint32_t now)
+{
+	uint32_t counts[SCAN_CLASS_COUNT];
+	uint32_t mesh_msgs;
+	uint32_t prov_msgs;
+
+	scan_dispatch_counts_get(counts);
+	mesh_msgs = counts[SCAN_CLASS_MESH_MSG] - last_counts[SCAN_CLASS_MESH_MSG];
+	prov_msgs = counts[SCAN_CLASS_MESH_PROV] - last_counts[SCAN_CLASS_MESH_PROV];
+	memcpy(last_counts, counts, sizeof(last_counts));
+
+	/* PB-ADV traffic means a provisioning link is up around us */
+	if (prov_msgs || (int32_t)(atomic_get(&kick_until_ms) - now) > 0) {
+		return SCAN_MODE_DISCOVERY;
+	}
+
+	/* Mesh does not expose its relay queue, the traffic we hear is the
+	 * closest measure of it. Our advertisements compete with it in the
+	 * scanners of our peers.
+	 */
+	if (mesh_msgs >= CONFIG_BL_SCAN_SCHED_MESH_BUSY) {
+		return SCAN_MODE_TRACKING;
+	}
+
+	/* Just powered up, the neighbourhood has not heard of us yet */
+	if (!bt_mesh_is_provisioned()) {
+		return SCAN_MODE_TRACKING;
+	}
+
+	return SCAN_MODE_RELAXED;
+}
+
+static int sched_mode_apply(enum scan_mode mode)
+{
+	int err = peer_adv_interval_set(mode_interval[mode].min, mode_interval[mode].max);
+	if (err) {
+		LOG_ERR("Failed to apply %s mode (err %d)", mode_name[mode], err);
+		return err;
+	}
+
+	LOG_DBG("Advertising mode %s", mode_name[mode]);
+
+	return 0;
+}
+
+/* The mode only changes once applied, a failed switch is retried on a
+ * later period.
+ */
+static void sched_mode_set(enum scan_mode mode)
+{
+	if (sched_mode_apply(mode)) {
+		return;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	stats.mode = mode;
+	stats.switches++;
+
+	k_spin_unlock(&stats_lock, key);
+}
+
+static void sched_work_handle(struct k_work *item)
+{
+	uint32_t now = k_uptime_get_32();
+	enum scan_mode demand = sched_demand(now);
+
+	stats_account(now);
+
+	if (demand < stats.mode) {
+		sched_mode_set(demand);
+	} else if (demand == stats.mode) {
+		lower_since_ms = now;
+	} else if (now - lower_since_ms >= CONFIG_BL_SCAN_SCHED_HOLD_MS) {
+		/* One step at a time, the load has been lower for the hold time */
+		sched_mode_set(stats.mode + 1);
+		lower_since_ms = now;
+	}
+
+	k_work_reschedule(&sched_work, K_MSEC(CONFIG_BL_SCAN_SCHED_PERIOD_MS));
+}
+
+int scan_sched_start(void)
+{
+	uint32_t now = k_uptime_get_32();
+
+	mode_since_ms = now;
+	lower_since_ms = now;
+	scan_dispatch_counts_get(last_counts);
+
+	/* Everything is new at boot, peer advertising starts at the discovery
+	 * interval.
+	 */
+	atomic_set(&kick_until_ms, now + CONFIG_BL_SCAN_SCHED_HOLD_MS);
+	started = true;
+	k_work_reschedule(&sched_work, K_MSEC(CONFIG_BL_SCAN_SCHED_PERIOD_MS));
+
+	return 0;
+}
+
+void scan_sched_kick(void)
+{
+	atomic_set(&kick_until_ms, k_uptime_get_32() + CONFIG_BL_SCAN_SCHED_HOLD_MS);
+
+	/* Step up right away instead of on the next period */
+	if (started && stats.mode != SCAN_MODE_DISCOVERY) {
+		k_work_reschedule(&sched_work, K_NO_WAIT);
+	}
+}
+
+void scan_sched_stats_get(struct scan_sched_stats *out)
+{
+	uint32_t now = k_uptime_get_32();
+
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	*out = stats;
+	out->mode_ms[stats.mode] += now - mode_since_ms;
+
+	k_spin_unlock(&stats_lock, key);
+}
@@ -0,0 +1,252 @@
+#include <stdlib.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/mesh.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(sighting_pub, LOG_LEVEL_DBG);
+
+#include "fake_kconfig.h"
+
+#include "sighting_pub.h"
+#include "mesh_vnd.h"
+#include "peer_table.h"
+
+/* hw_id, RSSI, age */
+#define RECORD_LEN      (8 + 1 + 1)
+/* Record count */
+#define HEADER_LEN      1
+#define RECORDS_MAX     ((VND_PAYLOAD_MAX - HEADER_LEN) / RECORD_LEN)
+
+BUILD_ASSERT(RECORDS_MAX >= 1, "Not a single sighting fits in a message");
+
+/* Last report of each peer, to only report changes */
+struct pub_state {
+	uint64_t hw_id;
+	uint32_t sent_ms;
+	int8_t rssi;
+	bool used;
+};
+
+static const struct bt_mesh_model *sightings_model;
+static sighting_pub_recv_t recv_cb;
+
+/* Only touched from the system work queue */
+static struct pub_state published[CONFIG_BL_PEER_CAPACITY];
+static struct sighting_report pending[RECORDS_MAX];
+static size_t pending_count;
+static uint32_t pending_since_ms;
+
+static struct sighting_pub_stats stats;
+static struct k_spinlock stats_lock;
+
+static void check_work_handle(struct k_work *item);
+static K_WORK_DELAYABLE_DEFINE(check_work, check_work_handle);
+
+/* Linear, the table is as large as the peer table and walked once per check */
+static struct pub_state *pub_state_find(uint64_t hw_id)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(published); i++) {
+		if (published[i].used && published[i].hw_id == hw_id) {
+			return &published[i];
+		}
+	}
+
+	return NULL;
+}
+
+/* Replaces the peer reported longest ago when full */
+static struct pub_state *pub_state_alloc(uint64_t hw_id, uint32_t now)
+{
+	struct pub_state *state = pub_state_find(hw_id);
+
+	if (state) {
+		return state;
+	}
+
+	state = &published[0];
+	for (size_t i = 0; i < ARRAY_SIZE(published); i++) {
+		if (!published[i].used) {
+			state = &published[i];
+			break;
+		}
+		if (now - published[i].sent_ms > now - state->sent_ms) {
+			state = &published[i];
+		}
+	}
+
+	state->used = true;
+	state->hw_id = hw_id;
+
+	return state;
+}
+
+static void pending_add(uint64_t hw_id, int8_t rssi, uint8_t age, uint32_t now)
+{
+	for (size_t i = 0; i < pending_count; i++) {
+		if (pending[i].hw_id == hw_id) {
+			pending[i].rssi = rssi;
+			pending[i].age = age;
+			return;
+		}
+	}
+
+	if (pending_count == 0) {
+		pending_since_ms = now;
+	}
+
+	pending[pending_count++] = (struct sighting_report) {
+		.hw_id = hw_id, .rssi = rssi, .age = age,
+	};
+}
+
+static int pending_flush(uint32_t now)
+{
+	BT_MESH_MODEL_BUF_DEFINE(msg, VND_OP_SIGHTINGS_STATUS, VND_PAYLOAD_MAX);
+	struct bt_mesh_msg_ctx ctx = BT_MESH_MSG_CTX_INIT_APP(CONFIG_BL_SIGHTINGS_APP_IDX,
+							      CONFIG_BL_SIGHTINGS_GROUP);
+	int err;
+
+	bt_mesh_model_msg_init(&msg, VND_OP_SIGHTINGS_STATUS);
+	net_buf_simple_add_u8(&msg, pending_count);
+	for (size_t i = 0; i < pending_count; i++) {
+		net_buf_simple_add_le64(&msg, pending[i].hw_id);
+		net_buf_simple_add_u8(&msg, (uint8_t)pending[i].rssi);
+		net_buf_simple_add_u8(&msg, pending[i].age);
+	}
+
+	/* Fails until the provisioner added the app key, the batch is kept */
+	err = bt_mesh_model_send(sightings_model, &ctx, &msg, NULL, NULL);
+
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	if (err) {
+		stats.send_failed++;
+	} else {
+		stats.messages++;
+		stats.published += pending_count;
+	}
+
+	k_spin_unlock(&stats_lock, key);
+
+	if (err) {
+		return err;
+	}
+
+	for (size_t i = 0; i < pending_count; i++) {
+		struct pub_state *state = pub_state_alloc(pending[i].hw_id, now);
+
+		state->sent_ms = now;
+		state->rssi = pending[i].rssi;
+	}
+	pending_count = 0;
+
+	return 0;
+}
+
+static bool collect(const struct peer_entry *entry, void *user_data)
+{
+	uint32_t now = *(uint32_t *)user_data;
+	int8_t rssi = PEER_RSSI_Q8_TO_DBM(entry->rssi_q8);
+	struct pub_state *state = pub_state_find(entry->hw_id);
+
+	if (state && abs(rssi - state->rssi) < CONFIG_BL_SIGHTINGS_RSSI_DELTA &&
+	    now - state->sent_ms < CONFIG_BL_SIGHTINGS_REFRESH_MS) {
+		return true;
+	}
+
+	/* Size threshold, a full batch goes out right away */
+	if (pending_count == ARRAY_SIZE(pending) && pending_flush(now)) {
+		return false;
+	}
+
+	pending_add(entry->hw_id, rssi, MIN((now - entry->last_seen_ms) / 100, UINT8_MAX), now);
+
+	return true;
+}
+
+static void check_work_handle(struct k_work *item)
+{
+	uint32_t now = k_uptime_get_32();
+
+	peer_table_foreach(collect, &now);
+
+	/* Time threshold, and full batches left over from the walk */
+	if (pending_count == ARRAY_SIZE(pending) ||
+	    (pending_count && now - pending_since_ms >= CONFIG_BL_SIGHTINGS_MAX_DELAY_MS)) {
+		(void)pending_flush(now);
+	}
+
+	k_work_reschedule(&check_work, K_MSEC(CONFIG_BL_SIGHTINGS_CHECK_MS));
+}
+
+int sighting_pub_start(void)
+{
+	if (!sightings_model) {
+		return -ENODEV;
+	}
+
+	k_work_reschedule(&check_work, K_MSEC(CONFIG_BL_SIGHTINGS_CHECK_MS));
+
+	return 0;
+}
+
+void sighting_pub_recv_set(sighting_pub_recv_t cb)
+{
+	recv_cb = cb;
+}
+
+void sighting_pub_stats_get(struct sighting_pub_stats *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	*out = stats;
+
+	k_spin_unlock(&stats_lock, key);
+}
+
+/* Model */
+static int sightings_status(const struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx,
+			    struct net_buf_simple *buf)
+{
+	struct sighting_report reports[RECORDS_MAX];
+	uint8_t count = net_buf_simple_pull_u8(buf);
+
+	if (count > ARRAY_SIZE(reports) || buf->len != count * RECORD_LEN) {
+		return -EINVAL;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		reports[i].hw_id = net_buf_simple_pull_le64(buf);
+		reports[i].rssi = (int8_t)net_buf_simple_pull_u8(buf);
+		reports[i].age = net_buf_simple_pull_u8(buf);
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	stats.received += count;
+
+	k_spin_unlock(&stats_lock, key);
+
+	if (recv_cb) {
+		recv_cb(ctx->addr, reports, count);
+	}
+
+	return 0;
+}
+
+const struct bt_mesh_model_op sighting_pub_ops[] = {
+	{ VND_OP_SIGHTINGS_STATUS, BT_MESH_LEN_MIN(HEADER_LEN), sightings_status },
+	BT_MESH_MODEL_OP_END,
+};
+
+static int sightings_init(const struct bt_mesh_model *model)
+{
+	sightings_model = model;
+
+	return 0;
+}
+
+const struct bt_mesh_model_cb sighting_pub_cb = {
+	.init = sightings_init,
+};
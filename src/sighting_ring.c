@@ -0,0 +1,83 @@
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+#include "fake_kconfig.h"
+
+#include "sighting_ring.h"
+
+BUILD_ASSERT(IS_POWER_OF_TWO(CONFIG_BL_SIGHTING_RING_SIZE), "Sighting ring size must be a power of two");
+
+#define RING_MASK (CONFIG_BL_SIGHTING_RING_SIZE - 1)
+
+static struct peer_sighting ring[CONFIG_BL_SIGHTING_RING_SIZE];
+
+/* Free running indices, the atomics provide the ordering between the slot
+ * copy and the index update. atomic_val_t is signed, so the indices are
+ * read into uint32_t and all arithmetic wraps unsigned.
+ */
+static atomic_t ring_head;
+static atomic_t ring_tail;
+
+/* Producer owned */
+static uint32_t stat_pushed;
+static uint32_t stat_dropped;
+static uint32_t stat_high_water;
+
+/* Consumer owned */
+static uint32_t stat_drained;
+static uint32_t stat_batches;
+
+bool sighting_ring_push(const struct peer_sighting *sighting)
+{
+	uint32_t head = (uint32_t)atomic_get(&ring_head);
+	uint32_t used = head - (uint32_t)atomic_get(&ring_tail);
+
+	if (used >= CONFIG_BL_SIGHTING_RING_SIZE) {
+		stat_dropped++;
+		return false;
+	}
+
+	ring[head & RING_MASK] = *sighting;
+	atomic_set(&ring_head, (atomic_val_t)(head + 1));
+
+	stat_pushed++;
+	if (used + 1 > stat_high_water) {
+		stat_high_water = used + 1;
+	}
+
+	return true;
+}
+
+size_t sighting_ring_pop_batch(struct peer_sighting *out, size_t max)
+{
+	uint32_t tail = (uint32_t)atomic_get(&ring_tail);
+	size_t count = MIN((size_t)((uint32_t)atomic_get(&ring_head) - tail), max);
+
+	for (size_t i = 0; i < count; i++) {
+		out[i] = ring[(tail + i) & RING_MASK];
+	}
+
+	atomic_set(&ring_tail, (atomic_val_t)(tail + (uint32_t)count));
+
+	if (count) {
+		stat_drained += count;
+		stat_batches++;
+	}
+
+	return count;
+}
+
+bool sighting_ring_empty(void)
+{
+	return atomic_get(&ring_head) == atomic_get(&ring_tail);
+}
+
+void sighting_ring_stats_get(struct sighting_ring_stats *stats)
+{
+	stats->pushed = stat_pushed;
+	stats->dropped = stat_dropped;
+	stats->high_water = stat_high_water;
+	stats->drained = stat_drained;
+	stats->batches = stat_batches;
+}
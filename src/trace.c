@@ -0,0 +1,157 @@
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/uart.h>
+
+#if IS_ENABLED(CONFIG_USE_SEGGER_RTT)
+#include <SEGGER_RTT.h>
+#endif
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(trace, LOG_LEVEL_DBG);
+
+#include "fake_kconfig.h"
+
+#include "trace.h"
+
+BUILD_ASSERT(IS_POWER_OF_TWO(CONFIG_BL_TRACE_RING_SIZE), "Trace ring size must be a power of two");
+
+#define RING_MASK (CONFIG_BL_TRACE_RING_SIZE - 1)
+
+/* Frames start with a sync byte pair so the decoder can pick up mid stream */
+static const uint8_t frame_sync[2] = { 0xA5, 0x5A };
+
+static struct trace_record ring[CONFIG_BL_TRACE_RING_SIZE];
+static uint32_t ring_head;
+static uint32_t ring_tail;
+static uint32_t overwritten;
+static struct k_spinlock ring_lock;
+
+static void drain_work_handle(struct k_work *item);
+static K_WORK_DELAYABLE_DEFINE(drain_work, drain_work_handle);
+
+#if IS_ENABLED(CONFIG_BL_TRACE_BACKEND_RTT)
+static uint8_t rtt_buf[CONFIG_BL_TRACE_RTT_BUF_SIZE];
+#elif DT_HAS_CHOSEN(bl_trace_uart)
+static const struct device *const trace_uart = DEVICE_DT_GET(DT_CHOSEN(bl_trace_uart));
+#endif
+
+static int backend_init(void)
+{
+#if IS_ENABLED(CONFIG_BL_TRACE_BACKEND_RTT)
+	SEGGER_RTT_ConfigUpBuffer(CONFIG_BL_TRACE_RTT_CHANNEL, "trace", rtt_buf, sizeof(rtt_buf),
+				  SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+	return 0;
+#elif DT_HAS_CHOSEN(bl_trace_uart)
+	return device_is_ready(trace_uart) ? 0 : -ENODEV;
+#else
+	LOG_ERR("No trace backend, select RTT or set the bl,trace-uart chosen node");
+	return -ENOTSUP;
+#endif
+}
+
+static void backend_write(const void *data, size_t len)
+{
+#if IS_ENABLED(CONFIG_BL_TRACE_BACKEND_RTT)
+	SEGGER_RTT_Write(CONFIG_BL_TRACE_RTT_CHANNEL, data, len);
+#elif DT_HAS_CHOSEN(bl_trace_uart)
+	for (size_t i = 0; i < len; i++) {
+		uart_poll_out(trace_uart, ((const uint8_t *)data)[i]);
+	}
+#endif
+}
+
+/* One write per frame, RTT takes its lock once and a frame is never split */
+static void record_write(const struct trace_record *record)
+{
+	uint8_t frame[sizeof(frame_sync) + sizeof(*record)];
+
+	memcpy(frame, frame_sync, sizeof(frame_sync));
+	memcpy(&frame[sizeof(frame_sync)], record, sizeof(*record));
+	backend_write(frame, sizeof(frame));
+}
+
+void trace_event(uint16_t event, uint16_t arg0, uint32_t arg1, uint32_t arg2)
+{
+	uint32_t timestamp = k_cycle_get_32();
+
+	k_spinlock_key_t key = k_spin_lock(&ring_lock);
+
+	if (ring_head - ring_tail == CONFIG_BL_TRACE_RING_SIZE) {
+		ring_tail++;
+		overwritten++;
+	}
+
+	ring[ring_head & RING_MASK] = (struct trace_record) {
+		.timestamp = timestamp,
+		.event = event,
+		.arg0 = arg0,
+		.arg1 = arg1,
+		.arg2 = arg2,
+	};
+	ring_head++;
+
+	k_spin_unlock(&ring_lock, key);
+}
+
+static void drain_work_handle(struct k_work *item)
+{
+	struct trace_record batch[CONFIG_BL_TRACE_DRAIN_BATCH];
+	uint32_t lost;
+	size_t count;
+
+	do {
+		k_spinlock_key_t key = k_spin_lock(&ring_lock);
+
+		count = MIN(ring_head - ring_tail, ARRAY_SIZE(batch));
+		for (size_t i = 0; i < count; i++) {
+			batch[i] = ring[(ring_tail + i) & RING_MASK];
+		}
+		ring_tail += count;
+		lost = overwritten;
+		overwritten = 0;
+
+		k_spin_unlock(&ring_lock, key);
+
+		if (lost) {
+			const struct trace_record overrun = {
+				.timestamp = k_cycle_get_32(),
+				.event = TRACE_EVT_OVERRUN,
+				.arg1 = lost,
+			};
+
+			record_write(&overrun);
+		}
+
+		for (size_t i = 0; i < count; i++) {
+			record_write(&batch[i]);
+		}
+	} while (count == ARRAY_SIZE(batch));
+
+	k_work_reschedule(&drain_work, K_MSEC(CONFIG_BL_TRACE_DRAIN_MS));
+}
+
+int trace_start(void)
+{
+	if (!IS_ENABLED(CONFIG_BL_TRACE)) {
+		return 0;
+	}
+
+	int err = backend_init();
+	if (err) {
+		return err;
+	}
+
+	const struct trace_record clock = {
+		.timestamp = k_cycle_get_32(),
+		.event = TRACE_EVT_CLOCK,
+		.arg1 = sys_clock_hw_cycles_per_sec(),
+	};
+
+	record_write(&clock);
+	k_work_reschedule(&drain_work, K_MSEC(CONFIG_BL_TRACE_DRAIN_MS));
+
+	return 0;
+}
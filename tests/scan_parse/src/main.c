@@ -0,0 +1,253 @@
+#include <string.h>
+
+#include <zephyr/ztest.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/gap.h>
+
+#include "peer.h"
+#include "scan_dispatch.h"
+
+#define TEST_HW_ID 0x0123456789ABCDEFULL
+
+/* Rounds over all vectors per timed case. Long enough for a 32 kHz cycle
+ * counter, short of k_cycle_get_32 wrapping on a 64 MHz one.
+ */
+#define BENCH_ROUNDS 10000
+
+#define MFG_PEER(company, code)						\
+	BT_DATA_MANUFACTURER_DATA,					\
+	(company) & 0xff, (company) >> 8,				\
+	(code) & 0xff, ((code) >> 8) & 0xff,				\
+	((code) >> 16) & 0xff, (code) >> 24,				\
+	0xEF, 0xCD, 0xAB, 0x89, 0x67, 0x45, 0x23, 0x01
+
+struct parse_vector {
+	const char *name;
+	const uint8_t *data;
+	uint8_t len;
+	enum scan_class cls;
+	bool peer;
+};
+
+#define VECTOR(n, c, p, ...)							\
+	{									\
+		.name = n,							\
+		.data = (const uint8_t []){ __VA_ARGS__ },			\
+		.len = sizeof((const uint8_t []){ __VA_ARGS__ }),		\
+		.cls = c,							\
+		.peer = p,							\
+	}
+
+/* Roughly what a busy mesh neighbourhood looks like */
+static const struct parse_vector vectors[] = {
+	VECTOR("mesh message", SCAN_CLASS_MESH_MSG, false,
+	       0x0c, BT_DATA_MESH_MESSAGE, 0x68, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+	       0x88, 0x99, 0xaa),
+	VECTOR("mesh beacon", SCAN_CLASS_MESH_BEACON, false,
+	       0x03, BT_DATA_MESH_BEACON, 0x00, 0xdd),
+	VECTOR("mesh prov", SCAN_CLASS_MESH_PROV, false,
+	       0x06, BT_DATA_MESH_PROV, 0x01, 0x02, 0x03, 0x04, 0x05),
+	VECTOR("peer", SCAN_CLASS_MFG, true,
+	       0x02, BT_DATA_FLAGS, 0x06,
+	       0x0f, MFG_PEER(CONFIG_BT_COMPANY_ID_NORDIC, SUPPORT_PEER_CODE)),
+	VECTOR("peer after name", SCAN_CLASS_MFG, true,
+	       0x03, BT_DATA_NAME_SHORTENED, 'S', 'C',
+	       0x0f, MFG_PEER(CONFIG_BT_COMPANY_ID_NORDIC, SUPPORT_PEER_CODE)),
+	VECTOR("foreign company", SCAN_CLASS_MFG, false,
+	       0x02, BT_DATA_FLAGS, 0x06,
+	       0x0f, MFG_PEER(0x004c, SUPPORT_PEER_CODE)),
+	VECTOR("foreign code", SCAN_CLASS_MFG, false,
+	       0x0f, MFG_PEER(CONFIG_BT_COMPANY_ID_NORDIC, 0x12345678)),
+	VECTOR("short mfg", SCAN_CLASS_MFG, false,
+	       0x05, BT_DATA_MANUFACTURER_DATA, 0x59, 0x00, 0xff, 0xdd),
+	VECTOR("name only", SCAN_CLASS_OTHER, false,
+	       0x07, BT_DATA_NAME_COMPLETE, 'S', 'C', 'A', 'N', '_', 'M'),
+	VECTOR("length overrun", SCAN_CLASS_OTHER, false,
+	       0x02, BT_DATA_FLAGS, 0x06, 0x1f, BT_DATA_MANUFACTURER_DATA, 0x59, 0x00),
+	VECTOR("early termination", SCAN_CLASS_OTHER, false,
+	       0x02, BT_DATA_FLAGS, 0x06, 0x00, 0x0f, BT_DATA_MANUFACTURER_DATA),
+};
+
+/* What the peer consumer saw of the last report */
+static struct {
+	uint32_t calls;
+	uint32_t peers;
+	enum scan_class cls;
+	bool peer;
+} seen;
+
+/* Does what the peer consumer does on the RX thread, less the ring push */
+static void consumer_recv(enum scan_class cls, const struct scan_report *report)
+{
+	uint64_t hw_id;
+
+	seen.calls++;
+	seen.cls = cls;
+	seen.peer = peer_mfg_match(report->data, report->data_len, &hw_id);
+	seen.peers += seen.peer;
+}
+
+static struct scan_consumer consumer = {
+	.class_mask = BIT(SCAN_CLASS_MFG),
+	.recv = consumer_recv,
+};
+
+static enum scan_class classify(const struct parse_vector *vector, struct scan_report *report)
+{
+	struct net_buf_simple buf;
+
+	net_buf_simple_init_with_data(&buf, (void *)vector->data, vector->len);
+
+	return scan_classify(&buf, report);
+}
+
+static void dispatch(const struct parse_vector *vector)
+{
+	struct bt_le_scan_recv_info info = { .rssi = -60 };
+	struct net_buf_simple buf;
+
+	net_buf_simple_init_with_data(&buf, (void *)vector->data, vector->len);
+
+	scan_dispatch_recv(&info, &buf);
+}
+
+static uint32_t peer_vectors(void)
+{
+	uint32_t count = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(vectors); i++) {
+		count += vectors[i].peer;
+	}
+
+	return count;
+}
+
+static void bench_print(const char *name, uint32_t cycles)
+{
+	uint32_t reports = BENCH_ROUNDS * ARRAY_SIZE(vectors);
+	uint64_t milli = (uint64_t)cycles * 1000 / reports;
+
+	/* native_sim time only advances while the CPU idles */
+	if (!cycles) {
+		TC_PRINT("%s: no cycles counted, time does not run on this platform\n", name);
+		return;
+	}
+
+	TC_PRINT("%s: %u.%03u cycles/report, %llu reports/s\n", name,
+		 (uint32_t)(milli / 1000), (uint32_t)(milli % 1000),
+		 (unsigned long long)sys_clock_hw_cycles_per_sec() * reports / cycles);
+}
+
+ZTEST(scan_parse, test_classify)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(vectors); i++) {
+		struct scan_report report = { 0 };
+		enum scan_class cls = classify(&vectors[i], &report);
+
+		zassert_equal(cls, vectors[i].cls, "%s: class %d, expected %d",
+			      vectors[i].name, cls, vectors[i].cls);
+
+		if (cls == SCAN_CLASS_OTHER) {
+			zassert_is_null(report.data, "%s: payload set", vectors[i].name);
+			continue;
+		}
+
+		/* The payload of the deciding AD structure, in place */
+		zassert_true(report.data > vectors[i].data &&
+			     report.data + report.data_len <= vectors[i].data + vectors[i].len,
+			     "%s: payload outside of the report", vectors[i].name);
+		zassert_equal(report.data[-2], report.data_len + 1, "%s: payload length %u",
+			      vectors[i].name, report.data_len);
+	}
+}
+
+ZTEST(scan_parse, test_peer_match)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(vectors); i++) {
+		struct scan_report report = { 0 };
+		uint64_t hw_id = 0;
+		bool peer = classify(&vectors[i], &report) == SCAN_CLASS_MFG &&
+			    peer_mfg_match(report.data, report.data_len, &hw_id);
+
+		zassert_equal(peer, vectors[i].peer, "%s: peer %d, expected %d",
+			      vectors[i].name, peer, vectors[i].peer);
+		if (peer) {
+			zassert_equal(hw_id, TEST_HW_ID, "%s: hw_id %016llx", vectors[i].name,
+				      (unsigned long long)hw_id);
+		}
+	}
+}
+
+ZTEST(scan_parse, test_dispatch)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(vectors); i++) {
+		uint32_t before[SCAN_CLASS_COUNT];
+		uint32_t after[SCAN_CLASS_COUNT];
+		enum scan_class cls = vectors[i].cls;
+		bool wanted = consumer.class_mask & BIT(cls);
+
+		memset(&seen, 0, sizeof(seen));
+		scan_dispatch_counts_get(before);
+		dispatch(&vectors[i]);
+		scan_dispatch_counts_get(after);
+
+		zassert_equal(after[cls] - before[cls], 1, "%s: not counted as class %d",
+			      vectors[i].name, cls);
+		zassert_equal(seen.calls, wanted, "%s: consumer called %u times",
+			      vectors[i].name, seen.calls);
+		if (wanted) {
+			zassert_equal(seen.cls, cls, "%s: consumer got class %d",
+				      vectors[i].name, seen.cls);
+			zassert_equal(seen.peer, vectors[i].peer, "%s: peer %d, expected %d",
+				      vectors[i].name, seen.peer, vectors[i].peer);
+		}
+	}
+}
+
+/* Classification and peer match, as the consumer runs them */
+ZTEST(scan_parse, test_bench_classify)
+{
+	uint32_t peers = 0;
+	uint32_t start = k_cycle_get_32();
+
+	for (int round = 0; round < BENCH_ROUNDS; round++) {
+		for (size_t i = 0; i < ARRAY_SIZE(vectors); i++) {
+			struct scan_report report;
+			uint64_t hw_id;
+
+			peers += classify(&vectors[i], &report) == SCAN_CLASS_MFG &&
+				 peer_mfg_match(report.data, report.data_len, &hw_id);
+		}
+	}
+
+	bench_print("classify", k_cycle_get_32() - start);
+	zassert_equal(peers, BENCH_ROUNDS * peer_vectors(), "%u peers matched", peers);
+}
+
+/* The whole listener: classify, count and hand to the consumer */
+ZTEST(scan_parse, test_bench_dispatch)
+{
+	uint32_t start;
+
+	memset(&seen, 0, sizeof(seen));
+	start = k_cycle_get_32();
+
+	for (int round = 0; round < BENCH_ROUNDS; round++) {
+		for (size_t i = 0; i < ARRAY_SIZE(vectors); i++) {
+			dispatch(&vectors[i]);
+		}
+	}
+
+	bench_print("dispatch", k_cycle_get_32() - start);
+	zassert_equal(seen.peers, BENCH_ROUNDS * peer_vectors(), "%u peers matched",
+		      seen.peers);
+}
+
+static void *scan_parse_setup(void)
+{
+	zassert_ok(scan_dispatch_register(&consumer), "Consumer not registered");
+
+	return NULL;
+}
+
+ZTEST_SUITE(scan_parse, NULL, scan_parse_setup, NULL, NULL, NULL);